@@ -0,0 +1,147 @@
+/*
+Copyright (c) 2014 Austin Fox (fostinaux@gmail.com)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#include "egatom.h"
+#include "egmem.h"
+#include "util/array.h"
+
+#include <string.h>
+
+//atom a's name is entry a - 1 of atomNames. the name strings live in an arena and never move,
+//so the map can key on the name pointers and take strings of any length
+egMap atomMap = {0};
+egVec atomNames = {0};
+egMemArena atomStrings = {0};
+
+static int egAtomNameCmp(const void * a, const void * b)
+{
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+//fnv-1a over the whole name
+static uint32_t egAtomNameHash(const void * key)
+{
+    const unsigned char * c = *(const unsigned char * const *)key;
+    uint32_t hash = 2166136261u;
+    while (*c) {
+        hash ^= *c++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void egAtomsInit(void)
+{
+    if (atomMap.kcomp == 0) {
+        atomMap = eg_map_new_hash(64, sizeof(char*), sizeof(egAtom), egAtomNameCmp, egAtomNameHash);
+        atomNames = eg_vec_new(64, sizeof(char*));
+        egMemArenaNew(&atomStrings, 4096);
+    }
+}
+
+egAtom egAtomIntern(const char * name)
+{
+    egAtom atom = egAtomFind(name);
+    if (atom != EG_ATOM_NONE) {
+        return atom;
+    }
+    return egAtomInternN(name, strlen(name));
+}
+
+egAtom egAtomInternN(const char * name, size_t length)
+{
+    egMemArenaMarker mark;
+    egAtom atom, * found;
+    char * copy;
+
+    egAtomsInit();
+
+    //copy the name first so it can be looked up terminated, and take it back if it's already there
+    mark = egMemArenaMark(&atomStrings);
+    copy = egMemArenaAlloc(&atomStrings, length + 1, 1);
+    if (copy == 0) {
+        return EG_ATOM_NONE;
+    }
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+
+    found = eg_map_get(&atomMap, &copy, 0);
+    if (found) {
+        egMemArenaRollback(&atomStrings, mark);
+        return *found;
+    }
+
+    atom = atomNames.element_count + 1;
+    eg_vec_push(&atomNames, &copy);
+    if (atomNames.element_count != atom || eg_map_insert(&atomMap, &copy, &atom) == 0) {
+        atomNames.element_count = atom - 1;
+        egMemArenaRollback(&atomStrings, mark);
+        return EG_ATOM_NONE;
+    }
+    return atom;
+}
+
+egAtom egAtomFind(const char * name)
+{
+    egAtom * found;
+    if (atomMap.kcomp == 0) {
+        return EG_ATOM_NONE;
+    }
+    found = eg_map_get(&atomMap, &name, 0);
+    return found ? *found : EG_ATOM_NONE;
+}
+
+const char * egAtomName(egAtom atom)
+{
+    char ** name;
+    if (atom == EG_ATOM_NONE) {
+        return 0;
+    }
+    name = eg_vec_at(&atomNames, atom - 1);
+    return name ? *name : 0;
+}
+
+size_t egAtomCount(void)
+{
+    return atomNames.element_count;
+}
+
+int egAtomCmp(const void * a, const void * b)
+{
+    egAtom x = *(const egAtom*)a, y = *(const egAtom*)b;
+    return (x > y) - (x < y);
+}
+
+//atoms are handed out in sequence, and multiplying by an odd constant maps any run of them onto distinct low bits
+uint32_t egAtomHash(const void * key)
+{
+    return *(const egAtom*)key * 2654435769u;
+}
+
+void egAtomsDeInit(void)
+{
+    if (atomMap.kcomp) {
+        eg_map_free(&atomMap);
+        eg_vec_free(&atomNames);
+        egMemArenaFree(&atomStrings);
+        atomMap.kcomp = 0;
+    }
+}
@@ -0,0 +1,50 @@
+/*
+Copyright (c) 2014 Austin Fox (fostinaux@gmail.com)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+//interned name. every distinct string gets one small integer for the life of the program, so names can be
+//stored and compared as 4 byte ids. atoms count up from 1, and EG_ATOM_NONE is never a valid name
+typedef uint32_t egAtom;
+
+#define EG_ATOM_NONE 0
+
+//return the atom for name, adding it if it's new. names can be any length. EG_ATOM_NONE if out of memory
+egAtom egAtomIntern(const char * name);
+
+//intern the first length characters of name, which needn't be terminated
+egAtom egAtomInternN(const char * name, size_t length);
+
+//return the atom for name without adding it, or EG_ATOM_NONE if it was never interned
+egAtom egAtomFind(const char * name);
+
+//the interned copy of the atom's name, or null for an unknown atom
+const char * egAtomName(egAtom atom);
+
+size_t egAtomCount(void);
+
+//key comparison and hash for an egMap keyed by atoms
+int egAtomCmp(const void * a, const void * b);
+uint32_t egAtomHash(const void * key);
+
+void egAtomsDeInit(void);
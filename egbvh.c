@@ -0,0 +1,576 @@
+/*
+Copyright (c) 2014 Austin Fox (fostinaux@gmail.com)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#include "egbvh.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+//the tree stays within about 1.44 log2 n levels, so this is plenty for the walks' explicit stacks.
+//a degenerate tree can still fill it, then the stack moves to the heap, see egBVHStackGrow
+#define EG_BVH_STACK 256
+
+//a raycast stack entry, with the fraction along the ray where it enters the node's box
+typedef struct egBVHRayEntry {
+    int32_t node;
+    float entry;
+} egBVHRayEntry;
+
+static egAABB egAABBUnion(egAABB a, egAABB b)
+{
+    egAABB u;
+    u.min.x = (a.min.x < b.min.x) ? a.min.x : b.min.x;
+    u.min.y = (a.min.y < b.min.y) ? a.min.y : b.min.y;
+    u.max.x = (a.max.x > b.max.x) ? a.max.x : b.max.x;
+    u.max.y = (a.max.y > b.max.y) ? a.max.y : b.max.y;
+    return u;
+}
+
+static float egAABBPerimeter(egAABB a)
+{
+    return 2.0f * ((a.max.x - a.min.x) + (a.max.y - a.min.y));
+}
+
+//narrow the range tmin..tmax of the segment to the part between lo and hi on one axis. return 0 if it's empty
+static int egAABBSlab(float from, float delta, float lo, float hi, float * tmin, float * tmax)
+{
+    float t0, t1, swap;
+    if (fabsf(delta) < 1e-12f) {
+        //parallel to the slab
+        return from >= lo && from <= hi;
+    }
+    t0 = (lo - from) / delta;
+    t1 = (hi - from) / delta;
+    if (t0 > t1) {
+        swap = t0;
+        t0 = t1;
+        t1 = swap;
+    }
+    if (t0 > *tmin) {
+        *tmin = t0;
+    }
+    if (t1 < *tmax) {
+        *tmax = t1;
+    }
+    return *tmin <= *tmax;
+}
+
+float egAABBRay(egAABB box, egV2 from, egV2 to)
+{
+    float tmin = 0.0f, tmax = 1.0f;
+    if (!egAABBSlab(from.x, to.x - from.x, box.min.x, box.max.x, &tmin, &tmax) ||
+            !egAABBSlab(from.y, to.y - from.y, box.min.y, box.max.y, &tmin, &tmax)) {
+        return -1.0f;
+    }
+    return tmin;
+}
+
+//put nodes first .. capacity on the free list
+static void egBVHLinkFree(egBVH * t, size_t first)
+{
+    for (size_t i = first; i < t->node_capacity; ++i) {
+        t->nodes[i].parent = (i + 1 < t->node_capacity) ? (int32_t)(i + 1) : t->free_list;
+        t->nodes[i].height = -1;
+    }
+    if (first < t->node_capacity) {
+        t->free_list = first;
+    }
+}
+
+int		egBVHNew(egBVH * t, size_t leaf_capacity, float margin)
+{
+    t->node_capacity = leaf_capacity ? 2 * leaf_capacity : 16;
+    t->nodes = malloc(t->node_capacity * sizeof(egBVHNode));
+    t->node_count = 0;
+    t->root = EG_BVH_NULL;
+    t->free_list = EG_BVH_NULL;
+    t->margin = margin;
+    if (t->nodes == 0) {
+        t->node_capacity = 0;
+        return 0;
+    }
+    egBVHLinkFree(t, 0);
+    return 1;
+}
+
+void	egBVHFree(egBVH * t)
+{
+    free(t->nodes);
+    t->nodes = 0;
+    t->node_count = t->node_capacity = 0;
+    t->root = t->free_list = EG_BVH_NULL;
+}
+
+int		egBVHReserve(egBVH * t, size_t leaf_count)
+{
+    //a leaf takes a node for itself and one for its new parent
+    size_t needed = t->node_count + 2 * leaf_count, capacity = t->node_capacity ? t->node_capacity : 16, old;
+    egBVHNode * nodes;
+    if (needed <= t->node_capacity) {
+        return 1;
+    }
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    nodes = realloc(t->nodes, capacity * sizeof(egBVHNode));
+    if (nodes == 0) {
+        return 0;
+    }
+    old = t->node_capacity;
+    t->nodes = nodes;
+    t->node_capacity = capacity;
+    egBVHLinkFree(t, old);
+    return 1;
+}
+
+//callers reserve first, so there's always a free node
+static int32_t egBVHAllocNode(egBVH * t)
+{
+    int32_t i = t->free_list;
+    assert(i != EG_BVH_NULL);
+    t->free_list = t->nodes[i].parent;
+    t->nodes[i].parent = t->nodes[i].child1 = t->nodes[i].child2 = EG_BVH_NULL;
+    t->nodes[i].height = 0;
+    t->nodes[i].id = EG_HANDLE_NONE;
+    ++t->node_count;
+    return i;
+}
+
+static void egBVHFreeNode(egBVH * t, int32_t i)
+{
+    t->nodes[i].parent = t->free_list;
+    t->nodes[i].height = -1;
+    t->free_list = i;
+    --t->node_count;
+}
+
+//if a is unbalanced, rotate its taller child up into its place. return the index of the subtree's new root
+static int32_t egBVHBalance(egBVH * t, int32_t ia)
+{
+    egBVHNode * n = t->nodes, * a = &n[ia], * b, * c, * f, * g;
+    int32_t ib, ic, if_, ig, balance;
+
+    if (a->height < 2) {
+        return ia;
+    }
+    ib = a->child1;
+    ic = a->child2;
+    b = &n[ib];
+    c = &n[ic];
+    balance = c->height - b->height;
+
+    if (balance > 1) {
+        //c goes up, and a keeps b and whichever of c's children is shorter
+        if_ = c->child1;
+        ig = c->child2;
+        f = &n[if_];
+        g = &n[ig];
+        c->child1 = ia;
+        c->parent = a->parent;
+        a->parent = ic;
+        if (c->parent == EG_BVH_NULL) {
+            t->root = ic;
+        } else if (n[c->parent].child1 == ia) {
+            n[c->parent].child1 = ic;
+        } else {
+            n[c->parent].child2 = ic;
+        }
+        if (f->height > g->height) {
+            c->child2 = if_;
+            a->child2 = ig;
+            g->parent = ia;
+            a->box = egAABBUnion(b->box, g->box);
+            c->box = egAABBUnion(a->box, f->box);
+            a->height = 1 + ((b->height > g->height) ? b->height : g->height);
+            c->height = 1 + ((a->height > f->height) ? a->height : f->height);
+        } else {
+            c->child2 = ig;
+            a->child2 = if_;
+            f->parent = ia;
+            a->box = egAABBUnion(b->box, f->box);
+            c->box = egAABBUnion(a->box, g->box);
+            a->height = 1 + ((b->height > f->height) ? b->height : f->height);
+            c->height = 1 + ((a->height > g->height) ? a->height : g->height);
+        }
+        return ic;
+    }
+
+    if (balance < -1) {
+        //the mirror image, b goes up
+        if_ = b->child1;
+        ig = b->child2;
+        f = &n[if_];
+        g = &n[ig];
+        b->child1 = ia;
+        b->parent = a->parent;
+        a->parent = ib;
+        if (b->parent == EG_BVH_NULL) {
+            t->root = ib;
+        } else if (n[b->parent].child1 == ia) {
+            n[b->parent].child1 = ib;
+        } else {
+            n[b->parent].child2 = ib;
+        }
+        if (f->height > g->height) {
+            b->child2 = if_;
+            a->child1 = ig;
+            g->parent = ia;
+            a->box = egAABBUnion(c->box, g->box);
+            b->box = egAABBUnion(a->box, f->box);
+            a->height = 1 + ((c->height > g->height) ? c->height : g->height);
+            b->height = 1 + ((a->height > f->height) ? a->height : f->height);
+        } else {
+            b->child2 = ig;
+            a->child1 = if_;
+            f->parent = ia;
+            a->box = egAABBUnion(c->box, f->box);
+            b->box = egAABBUnion(a->box, g->box);
+            a->height = 1 + ((c->height > f->height) ? c->height : f->height);
+            b->height = 1 + ((a->height > g->height) ? a->height : g->height);
+        }
+        return ib;
+    }
+    return ia;
+}
+
+//walk up from i rebalancing and refitting every ancestor
+static void egBVHRefit(egBVH * t, int32_t i)
+{
+    egBVHNode * n = t->nodes;
+    int32_t c1, c2;
+    while (i != EG_BVH_NULL) {
+        i = egBVHBalance(t, i);
+        c1 = n[i].child1;
+        c2 = n[i].child2;
+        n[i].height = 1 + ((n[c1].height > n[c2].height) ? n[c1].height : n[c2].height);
+        n[i].box = egAABBUnion(n[c1].box, n[c2].box);
+        i = n[i].parent;
+    }
+}
+
+static void egBVHInsertLeaf(egBVH * t, int32_t leaf)
+{
+    egBVHNode * n;
+    egAABB box = t->nodes[leaf].box;
+    int32_t i = t->root, sibling, parent, old_parent, c1, c2;
+    float area, combined, cost, inherit, cost1, cost2;
+
+    if (i == EG_BVH_NULL) {
+        t->root = leaf;
+        t->nodes[leaf].parent = EG_BVH_NULL;
+        return;
+    }
+
+    //go down towards whichever child grows least by taking the leaf, until making a sibling of the
+    //current node is cheaper. costs are in perimeter, the 2d surface area heuristic
+    n = t->nodes;
+    while (n[i].height > 0) {
+        c1 = n[i].child1;
+        c2 = n[i].child2;
+        area = egAABBPerimeter(n[i].box);
+        combined = egAABBPerimeter(egAABBUnion(n[i].box, box));
+        cost = 2.0f * combined;
+        //every ancestor grows by this much whichever way we go
+        inherit = 2.0f * (combined - area);
+        cost1 = egAABBPerimeter(egAABBUnion(box, n[c1].box)) + inherit;
+        if (n[c1].height > 0) {
+            cost1 -= egAABBPerimeter(n[c1].box);
+        }
+        cost2 = egAABBPerimeter(egAABBUnion(box, n[c2].box)) + inherit;
+        if (n[c2].height > 0) {
+            cost2 -= egAABBPerimeter(n[c2].box);
+        }
+        if (cost < cost1 && cost < cost2) {
+            break;
+        }
+        i = (cost1 < cost2) ? c1 : c2;
+    }
+    sibling = i;
+
+    //a new parent takes the sibling's place, with the sibling and the leaf under it
+    old_parent = n[sibling].parent;
+    parent = egBVHAllocNode(t);
+    n[parent].parent = old_parent;
+    n[parent].box = egAABBUnion(box, n[sibling].box);
+    n[parent].height = n[sibling].height + 1;
+    n[parent].child1 = sibling;
+    n[parent].child2 = leaf;
+    n[sibling].parent = parent;
+    n[leaf].parent = parent;
+    if (old_parent == EG_BVH_NULL) {
+        t->root = parent;
+    } else if (n[old_parent].child1 == sibling) {
+        n[old_parent].child1 = parent;
+    } else {
+        n[old_parent].child2 = parent;
+    }
+
+    egBVHRefit(t, parent);
+}
+
+static void egBVHRemoveLeaf(egBVH * t, int32_t leaf)
+{
+    egBVHNode * n = t->nodes;
+    int32_t parent, grandparent, sibling;
+
+    if (leaf == t->root) {
+        t->root = EG_BVH_NULL;
+        return;
+    }
+    //the sibling takes the parent's place
+    parent = n[leaf].parent;
+    grandparent = n[parent].parent;
+    sibling = (n[parent].child1 == leaf) ? n[parent].child2 : n[parent].child1;
+    n[sibling].parent = grandparent;
+    egBVHFreeNode(t, parent);
+    if (grandparent == EG_BVH_NULL) {
+        t->root = sibling;
+        return;
+    }
+    if (n[grandparent].child1 == parent) {
+        n[grandparent].child1 = sibling;
+    } else {
+        n[grandparent].child2 = sibling;
+    }
+    egBVHRefit(t, grandparent);
+}
+
+int32_t	egBVHInsert(egBVH * t, egAABB box, egHandle id)
+{
+    int32_t leaf;
+    if (!egBVHReserve(t, 1)) {
+        return EG_BVH_NULL;
+    }
+    leaf = egBVHAllocNode(t);
+    t->nodes[leaf].box = egAABBN(box.min.x - t->margin, box.min.y - t->margin, box.max.x + t->margin, box.max.y + t->margin);
+    t->nodes[leaf].id = id;
+    egBVHInsertLeaf(t, leaf);
+    return leaf;
+}
+
+void	egBVHRemove(egBVH * t, int32_t proxy)
+{
+    assert(proxy >= 0 && (size_t)proxy < t->node_capacity && t->nodes[proxy].height == 0);
+    egBVHRemoveLeaf(t, proxy);
+    egBVHFreeNode(t, proxy);
+}
+
+int		egBVHMove(egBVH * t, int32_t proxy, egAABB box)
+{
+    if (egAABBContains(t->nodes[proxy].box, box)) {
+        return 0;
+    }
+    //removing the leaf frees its parent, so reinserting it can't run out of nodes
+    egBVHRemoveLeaf(t, proxy);
+    t->nodes[proxy].box = egAABBN(box.min.x - t->margin, box.min.y - t->margin, box.max.x + t->margin, box.max.y + t->margin);
+    egBVHInsertLeaf(t, proxy);
+    return 1;
+}
+
+//make room for at least count more entries of size bytes on a walk's stack. the stack starts out as local, an
+//array on the C stack, and is copied to the heap the first time it fills. return 0 if out of memory
+static int egBVHStackGrow(void ** stack, void * local, size_t * capacity, size_t top, size_t count, size_t size)
+{
+    size_t grown = *capacity * 2;
+    void * bigger;
+    if (top + count <= *capacity) {
+        return 1;
+    }
+    if (*stack == local) {
+        bigger = malloc(grown * size);
+        if (bigger) {
+            memcpy(bigger, local, top * size);
+        }
+    } else {
+        bigger = realloc(*stack, grown * size);
+    }
+    if (bigger == 0) {
+        return 0;
+    }
+    *stack = bigger;
+    *capacity = grown;
+    return 1;
+}
+
+int		egBVHQuery(egBVH * t, egAABB box, int (*found)(egHandle id, void * ctx), void * ctx)
+{
+    int32_t local[EG_BVH_STACK], * stack = local, i;
+    size_t top = 0, capacity = EG_BVH_STACK;
+    int result = 1;
+    egBVHNode * n;
+
+    if (t->root == EG_BVH_NULL) {
+        return 1;
+    }
+    stack[top++] = t->root;
+    while (top) {
+        i = stack[--top];
+        n = &t->nodes[i];
+        if (!egAABBOverlap(n->box, box)) {
+            continue;
+        }
+        if (n->height == 0) {
+            if (!found(n->id, ctx)) {
+                break;
+            }
+        } else {
+            if (!egBVHStackGrow((void**)&stack, local, &capacity, top, 2, sizeof(int32_t))) {
+                result = 0;
+                break;
+            }
+            stack[top++] = n->child1;
+            stack[top++] = n->child2;
+        }
+    }
+    if (stack != local) {
+        free(stack);
+    }
+    return result;
+}
+
+int		egBVHQueryPairs(egBVH * t, void (*found)(egHandle a, egHandle b, void * ctx), void * ctx)
+{
+    int32_t local[2 * EG_BVH_STACK], * stack = local, ia, ib, swap;
+    size_t top = 0, capacity = 2 * EG_BVH_STACK;
+    int result = 1;
+    egBVHNode * n = t->nodes, * a, * b;
+
+    //walk pairs of subtrees instead of querying once per leaf, so every overlap between two subtrees is found once.
+    //a pair of one node with itself stands for all the pairs inside it
+    if (t->root == EG_BVH_NULL) {
+        return 1;
+    }
+    stack[top++] = t->root;
+    stack[top++] = t->root;
+    while (top) {
+        ib = stack[--top];
+        ia = stack[--top];
+        a = &n[ia];
+        b = &n[ib];
+        if (ia == ib) {
+            if (a->height == 0) {
+                continue;
+            }
+            if (!egBVHStackGrow((void**)&stack, local, &capacity, top, 6, sizeof(int32_t))) {
+                result = 0;
+                break;
+            }
+            stack[top++] = a->child1;
+            stack[top++] = a->child2;
+            stack[top++] = a->child2;
+            stack[top++] = a->child2;
+            stack[top++] = a->child1;
+            stack[top++] = a->child1;
+            continue;
+        }
+        if (!egAABBOverlap(a->box, b->box)) {
+            continue;
+        }
+        if (a->height == 0 && b->height == 0) {
+            found(a->id, b->id, ctx);
+            continue;
+        }
+        //split whichever is a leaf's partner or the bigger of the two
+        if (b->height > 0 && (a->height == 0 || egAABBPerimeter(b->box) > egAABBPerimeter(a->box))) {
+            swap = ia;
+            ia = ib;
+            ib = swap;
+            a = &n[ia];
+        }
+        if (!egBVHStackGrow((void**)&stack, local, &capacity, top, 4, sizeof(int32_t))) {
+            result = 0;
+            break;
+        }
+        stack[top++] = a->child1;
+        stack[top++] = ib;
+        stack[top++] = a->child2;
+        stack[top++] = ib;
+    }
+    if (stack != local) {
+        free(stack);
+    }
+    return result;
+}
+
+int		egBVHRaycast(egBVH * t, egV2 from, egV2 to, float (*hit)(egHandle id, float max_fraction, void * ctx), void * ctx)
+{
+    egBVHRayEntry local[EG_BVH_STACK], * stack = local;
+    int32_t i, c1, c2;
+    float max_fraction = 1.0f, f1, f2, result;
+    size_t top = 0, capacity = EG_BVH_STACK;
+    int complete = 1;
+    egBVHNode * n;
+
+    if (t->root == EG_BVH_NULL) {
+        return 1;
+    }
+    stack[top].entry = egAABBRay(t->nodes[t->root].box, from, to);
+    stack[top++].node = t->root;
+    while (top) {
+        --top;
+        i = stack[top].node;
+        //anything entered past the nearest hit so far can't hold a nearer one
+        if (stack[top].entry < 0.0f || stack[top].entry > max_fraction) {
+            continue;
+        }
+        n = &t->nodes[i];
+        if (n->height == 0) {
+            result = hit(n->id, max_fraction, ctx);
+            if (result <= 0.0f) {
+                break;
+            }
+            if (result < max_fraction) {
+                max_fraction = result;
+            }
+            continue;
+        }
+        //push the farther child first so the nearer is looked at first
+        c1 = n->child1;
+        c2 = n->child2;
+        f1 = egAABBRay(t->nodes[c1].box, from, to);
+        f2 = egAABBRay(t->nodes[c2].box, from, to);
+        if (!egBVHStackGrow((void**)&stack, local, &capacity, top, 2, sizeof(egBVHRayEntry))) {
+            complete = 0;
+            break;
+        }
+        if (f1 >= 0.0f && (f2 < 0.0f || f1 <= f2)) {
+            stack[top].entry = f2;
+            stack[top++].node = c2;
+            stack[top].entry = f1;
+            stack[top++].node = c1;
+        } else {
+            stack[top].entry = f1;
+            stack[top++].node = c1;
+            stack[top].entry = f2;
+            stack[top++].node = c2;
+        }
+    }
+    if (stack != local) {
+        free(stack);
+    }
+    return complete;
+}
+
+int32_t	egBVHHeight(egBVH * t)
+{
+    return (t->root == EG_BVH_NULL) ? 0 : t->nodes[t->root].height;
+}
@@ -0,0 +1,106 @@
+/*
+Copyright (c) 2014 Austin Fox (fostinaux@gmail.com)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "util/egmath.h"
+#include "egmem.h"
+
+//2d axis aligned box
+typedef struct egAABB {
+    egV2 min, max;
+} egAABB;
+
+static inline egAABB egAABBN(float x0, float y0, float x1, float y1)
+{
+    egAABB b = {{x0, y0}, {x1, y1}};
+    return b;
+}
+
+static inline int egAABBOverlap(egAABB a, egAABB b)
+{
+    return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y;
+}
+
+//1 if inner is entirely inside outer
+static inline int egAABBContains(egAABB outer, egAABB inner)
+{
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && inner.max.x <= outer.max.x && inner.max.y <= outer.max.y;
+}
+
+//how far along the segment from -> to it enters box, from 0 to 1, or -1 if it misses. 0 if from is inside
+float egAABBRay(egAABB box, egV2 from, egV2 to);
+
+#define EG_BVH_NULL (-1)
+
+//dynamic bounding volume tree. leaves hold an id and a "fat" box, the box they were given grown by margin on every
+//side. moving a leaf only touches the tree once its new box pokes out of the fat one, so things that jitter or move
+//slowly cost a containment test. inserts pick the sibling that adds the least perimeter and removals rebalance with
+//rotations, keeping the height near log n. node indices are stable, nodes are kept in one array and recycled
+typedef struct egBVHNode {
+    egAABB box;
+    //free nodes use parent as the next free node
+    int32_t parent, child1, child2;
+    //0 for leaves, -1 for free nodes
+    int32_t height;
+    egHandle id;
+} egBVHNode;
+
+typedef struct egBVH {
+    egBVHNode * nodes;
+    size_t node_count, node_capacity;
+    int32_t root, free_list;
+    float margin;
+} egBVH;
+
+//return 0 if out of memory
+int		egBVHNew(egBVH * t, size_t leaf_capacity, float margin);
+void	egBVHFree(egBVH * t);
+
+//make sure the next leaf_count inserts can't fail. return 0 if out of memory
+int		egBVHReserve(egBVH * t, size_t leaf_count);
+
+//add a leaf for id covering box. return its proxy, which names it in the other calls, or EG_BVH_NULL if out of memory
+int32_t	egBVHInsert(egBVH * t, egAABB box, egHandle id);
+void	egBVHRemove(egBVH * t, int32_t proxy);
+
+//tell the tree a leaf now covers box. return 1 if it left its fat box and was reinserted
+int		egBVHMove(egBVH * t, int32_t proxy, egAABB box);
+
+//the callbacks below must not insert, remove or move leaves of the tree being walked.
+
+//the walks below return 0 if the tree was too deep for their stack and there was no memory to grow it,
+//in which case they stopped partway.
+
+//call found for every leaf whose fat box overlaps box, until it returns 0
+int		egBVHQuery(egBVH * t, egAABB box, int (*found)(egHandle id, void * ctx), void * ctx);
+
+//call found once for every pair of leaves whose fat boxes overlap
+int		egBVHQueryPairs(egBVH * t, void (*found)(egHandle a, egHandle b, void * ctx), void * ctx);
+
+//call hit for leaves whose fat box the segment from -> to passes through, roughly nearest first. hit gets the
+//current max fraction along the segment and returns a new one: the fraction of an actual hit to only look for nearer
+//ones, max_fraction or more to carry on, or 0 to stop
+int		egBVHRaycast(egBVH * t, egV2 from, egV2 to, float (*hit)(egHandle id, float max_fraction, void * ctx), void * ctx);
+
+//the height of the tree, 0 for a single leaf
+int32_t	egBVHHeight(egBVH * t);
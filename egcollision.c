@@ -20,16 +20,108 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 */
 #include "egcollision.h"
+#include "egbvh.h"
+#include "util/array.h"
+#include "util/sort.h"
 
 #include <stdio.h>
 #include <assert.h>
 #include <math.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 egMemPool colliders = 0;
 
+//sweep and prune broadphase. every collider has an entry holding its x extent, kept sorted by min.
+//colliders only move a little between ticks, so the list stays nearly sorted and an insertion sort
+//puts it right in close to linear time. colliders made since the last tick wait in sweepPending
+typedef struct egSweepEntry {
+    float min, max;
+    float min_y, max_y;
+    egHandle id;
+    uint32_t type, awake;
+} egSweepEntry;
+
+egVec sweep = {0};
+egVec sweepPending = {0};
+
+//once sorted, the entries' boxes are copied into sweepBounds, a column per side, so the overlap test can take
+//a run of candidates a vector at a time. the pairs it finds go to sweepPairs as entry indices
+enum {
+    EG_SWEEP_MIN_X = 0,
+    EG_SWEEP_MAX_X,
+    EG_SWEEP_MIN_Y,
+    EG_SWEEP_MAX_Y
+};
+
+typedef struct egSweepPair {
+    uint32_t a, b;
+} egSweepPair;
+
+egSoA sweepBounds = {0};
+egVec sweepPairs = {0};
+//set to start the sweep over on the next tick, with every collider queued
+int sweepRebuild = 0;
+
+//grid broadphase. each tick every active collider gets an item with the range of cells it touches, and a key for each
+//of those cells. radix sorting the keys brings everything in one cell together
+typedef struct egGridItem {
+    egHandle id;
+    uint32_t type, awake;
+    int32_t x0, y0, x1, y1;
+} egGridItem;
+
+int broadphase = EG_BROADPHASE_SWEEP;
+float cellSize = EG_COLLIDER_CELL_SIZE;
+egVec gridItems = {0};
+egVec gridKeys = {0};
+egVec gridScratch = {0};
+
+//every collider that isn't static has a leaf here, see egCollidersRefit
+egBVH tree = {0};
+
+//static colliders are left out of the broadphases and tree above, so static pairs are never looked at.
+//awake colliders find the statics they touch in staticTree instead. statics don't move, so it's never refit
+egBVH staticTree = {0};
+uint32_t sleepTicks = 0;
+
+//the broadphases only find contacts, the callbacks are called once they're all found. contacts are egSortKey64s
+//with the pair of handles in the key, lower index in the high half, and their types in the value the same way.
+//sorted by key, this tick's contacts are diffed against lastContacts' to make the begin, stay and end lists
+egVec contacts = {0};
+egVec lastContacts = {0};
+egVec contactScratch = {0};
+egVec contactEvents[EG_CONTACT_EVENTS] = {{0}};
+int dispatchByType = 0;
+
+//bit b of collideMask[a] is set if types a and b collide. kept symmetric
+uint32_t collideMask[EG_COLLIDER_TYPES] = {
+    0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu,
+    0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu,
+    0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu,
+    0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu
+};
+
 void egCollidersDeInit(void)
 {
-    //
+    egBVHFree(&tree);
+    egBVHFree(&staticTree);
+    eg_vec_free(&contacts);
+    eg_vec_free(&lastContacts);
+    eg_vec_free(&contactScratch);
+    for (int i = 0; i < EG_CONTACT_EVENTS; ++i) {
+        eg_vec_free(&contactEvents[i]);
+    }
+    eg_vec_free(&sweep);
+    eg_vec_free(&sweepPending);
+    eg_soa_free(&sweepBounds);
+    eg_vec_free(&sweepPairs);
+    eg_vec_free(&gridItems);
+    eg_vec_free(&gridKeys);
+    eg_vec_free(&gridScratch);
 }
 
 uint32_t egColliderCount()
@@ -45,16 +137,82 @@ egMemPool egColliderPool()
 void egCollidersInit(void)
 {
     atexit(egCollidersDeInit);
-    egMemPoolNew(&colliders, sizeof(egCollider), 16);
+    egCollidersNew(&colliders, 16, EG_MEMPOOL_CHUNKED);
+    egMemPoolSetTag(colliders, "colliders");
+    sweep = eg_vec_new(16, sizeof(egSweepEntry));
+    sweepPending = eg_vec_new(16, sizeof(egHandle));
+    sweepBounds = eg_soa_new(16);
+    eg_soa_add_column(&sweepBounds, "min_x", sizeof(float));
+    eg_soa_add_column(&sweepBounds, "max_x", sizeof(float));
+    eg_soa_add_column(&sweepBounds, "min_y", sizeof(float));
+    eg_soa_add_column(&sweepBounds, "max_y", sizeof(float));
+    sweepPairs = eg_vec_new(16, sizeof(egSweepPair));
+    gridItems = eg_vec_new(16, sizeof(egGridItem));
+    gridKeys = eg_vec_new(16, sizeof(egSortKey64));
+    gridScratch = eg_vec_new(16, sizeof(egSortKey64));
+    egBVHNew(&tree, 16, EG_COLLIDER_FAT_MARGIN);
+    egBVHNew(&staticTree, 16, 0.0f);
+    contacts = eg_vec_new(16, sizeof(egSortKey64));
+    lastContacts = eg_vec_new(16, sizeof(egSortKey64));
+    contactScratch = eg_vec_new(16, sizeof(egSortKey64));
+    for (int i = 0; i < EG_CONTACT_EVENTS; ++i) {
+        contactEvents[i] = eg_vec_new(16, sizeof(egContact));
+    }
 }
 
-uint32_t egColliderNew(float x, float y, float w, float h, uint32_t type, uint16_t (*collision)(egCollider *, egCollider *), void * userdata, uint32_t oid)
+void egCollidersSetBroadphase(int type, float cell_size)
 {
-    size_t id;
-    egCollider * c;
-    egMemPoolAlloc(colliders, (void*)&c, &id);
+    if (cell_size > 0) {
+        cellSize = cell_size;
+    }
+    if (type == broadphase) {
+        return;
+    }
+    broadphase = type;
+    //only the sweep keeps state between ticks
+    eg_vec_clear(&sweep);
+    eg_vec_clear(&sweepPending);
+    sweepRebuild = 1;
+}
 
+void egCollidersSetCollides(uint32_t a, uint32_t b, int collides)
+{
+    if (a >= EG_COLLIDER_TYPES || b >= EG_COLLIDER_TYPES) {
+        return;
+    }
+    if (collides) {
+        collideMask[a] |= 1u << b;
+        collideMask[b] |= 1u << a;
+    } else {
+        collideMask[a] &= ~(1u << b);
+        collideMask[b] &= ~(1u << a);
+    }
+}
 
+int egCollidersCollides(uint32_t a, uint32_t b)
+{
+    return a >= EG_COLLIDER_TYPES || b >= EG_COLLIDER_TYPES || ((collideMask[a] >> b) & 1);
+}
+
+void egCollidersSetMask(uint32_t type, uint32_t mask)
+{
+    for (uint32_t i = 0; i < EG_COLLIDER_TYPES; ++i) {
+        egCollidersSetCollides(type, i, (mask >> i) & 1);
+    }
+}
+
+static egAABB egColliderBox(egCollider * c)
+{
+    return egAABBN(c->position.x - c->width, c->position.y - c->height, c->position.x + c->width, c->position.y + c->height);
+}
+
+static int egColliderAwake(egCollider * c)
+{
+    return c->body == EG_COLLIDER_KINEMATIC || (c->body == EG_COLLIDER_DYNAMIC && !c->sleeping);
+}
+
+static void egColliderInit(egCollider * c, egHandle id, float x, float y, float w, float h, uint32_t type, uint16_t (*collision)(egCollider *, egCollider *), void * userdata, uint32_t oid)
+{
     c->position = egV2N(x, y);
     c->width = w * 0.5;
     c->height = h * 0.5;
@@ -64,57 +222,716 @@ uint32_t egColliderNew(float x, float y, float w, float h, uint32_t type, uint16
     c->collision = collision;
     c->oid = oid;
     c->active = 1;
+    c->body = EG_COLLIDER_DYNAMIC;
+    c->sleeping = 0;
+    c->still = 0;
+    c->last = c->position;
+    //space was reserved by the caller, this can't fail
+    c->proxy = egBVHInsert(&tree, egColliderBox(c), id);
+}
+
+egHandle egColliderNew(float x, float y, float w, float h, uint32_t type, uint16_t (*collision)(egCollider *, egCollider *), void * userdata, uint32_t oid)
+{
+    egHandle id, * pending;
+    egCollider * c;
+
+    //queue for the broadphase first, it's easier to take back than the collider
+    pending = eg_vec_emplace(&sweepPending);
+    if (pending == 0) {
+        return EG_HANDLE_NONE;
+    }
+    if (!egBVHReserve(&tree, 1)) {
+        --sweepPending.element_count;
+        return EG_HANDLE_NONE;
+    }
+    egMemPoolAlloc(colliders, (void*)&c, &id);
+    if (c == 0) {
+        --sweepPending.element_count;
+        return EG_HANDLE_NONE;
+    }
+    *pending = id;
+
+    egColliderInit(c, id, x, y, w, h, type, collision, userdata, oid);
 
     //printf("new collider created: %u\n next new id:%u\n", id, nextNewColliderID);
 
     return id;
 }
 
-egCollider * egColliderGet(uint32_t id)
+size_t egColliderNewBatch(size_t count, const egV2 * positions, float w, float h, uint32_t type, uint16_t (*collision)(egCollider *, egCollider *), void * const * userdata, uint32_t oid, egHandle * ids)
 {
-    egCollider * redirect;
-    egMemPoolGetP(colliders, (void*)&redirect, id);
-    return redirect;
+    egMemArenaMarker mark = egMemArenaMark(egMemFrameArena());
+    egCollider ** c = egMemArenaAlloc(egMemFrameArena(), count * sizeof(egCollider*), sizeof(egCollider*));
+    egHandle * pending = eg_vec_emplace_n(&sweepPending, count);
+    size_t made = 0;
+
+    if (c && pending && egBVHReserve(&tree, count)) {
+        made = egMemPoolAllocN(colliders, count, (void**)c, ids);
+    }
+    if (pending) {
+        sweepPending.element_count -= count - made;
+    }
+    for (size_t i = 0; i < made; ++i) {
+        egColliderInit(c[i], ids[i], positions[i].x, positions[i].y, w, h, type, collision, userdata ? userdata[i] : 0, oid);
+        pending[i] = ids[i];
+    }
+    egMemArenaRollback(egMemFrameArena(), mark);
+    return made;
 }
 
-void egColliderErase(uint32_t id)
+egCollider * egColliderGet(egHandle id)
 {
-    egMemPoolErase(colliders, id);
+    return egCollidersGet(colliders, id);
 }
 
-void egColliderDeactivate(uint32_t id)
+int egColliderErase(egHandle id)
 {
-    egColliderGet(id)->active = 0;
+    egCollider * c = egColliderGet(id);
+    int32_t proxy;
+    egBVH * from;
+
+    if (c == 0) {
+        return 0;
+    }
+    //the leaf only goes once the erase has gone through, a collider left alive still needs it
+    proxy = c->proxy;
+    from = (c->body == EG_COLLIDER_STATIC) ? &staticTree : &tree;
+    if (!egMemPoolErase(colliders, id)) {
+        return 0;
+    }
+    egBVHRemove(from, proxy);
+    return 1;
 }
 
-void egColliderActivate(uint32_t id)
+int egColliderSetBody(egHandle id, int body)
 {
-    egColliderGet(id)->active = 1;
+    egCollider * c = egColliderGet(id);
+    egBVH * from, * to;
+    int32_t proxy;
+
+    if (c == 0 || (body != EG_COLLIDER_DYNAMIC && body != EG_COLLIDER_STATIC && body != EG_COLLIDER_KINEMATIC)) {
+        return 0;
+    }
+    from = (c->body == EG_COLLIDER_STATIC) ? &staticTree : &tree;
+    to = (body == EG_COLLIDER_STATIC) ? &staticTree : &tree;
+    if (from != to) {
+        proxy = egBVHInsert(to, egColliderBox(c), id);
+        if (proxy == EG_BVH_NULL) {
+            return 0;
+        }
+        if (c->body == EG_COLLIDER_STATIC) {
+            //the sweep drops static entries as it refreshes them, so this one needs to go back in
+            sweepRebuild = 1;
+        }
+        egBVHRemove(from, c->proxy);
+        c->proxy = proxy;
+    }
+    c->body = body;
+    c->sleeping = 0;
+    c->still = 0;
+    return 1;
 }
 
-void egCollidersTick(void)
+void egCollidersSetSleepTicks(uint32_t ticks)
 {
+    sleepTicks = ticks;
+}
 
-    size_t id1 = egMemPoolFirst(colliders), id2;
-    egCollider *cur = (egCollider*)egMemPoolNext(colliders, &id1);
+void egColliderWake(egHandle id)
+{
+    egCollider * c = egColliderGet(id);
+    if (c) {
+        c->sleeping = 0;
+        c->still = 0;
+    }
+}
 
-    while (cur) {
-        id2 = id1;
-        egCollider *cmp = (egCollider*)egMemPoolNext(colliders, &id2);
-        while(cmp) {
-            if (cur->active && cmp->active &&
-                    fabs(cur->position.x - cmp->position.x) < (cur->width + cmp->width) &&
-                    fabs(cur->position.y - cmp->position.y) < (cur->height + cmp->height)) {
-                if (cur->collision) {
-                    cur->collision(cur, cmp);
-                }
+void egColliderDeactivate(egHandle id)
+{
+    egCollider * c = egColliderGet(id);
+    if (c) {
+        c->active = 0;
+    }
+}
+
+void egColliderActivate(egHandle id)
+{
+    egCollider * c = egColliderGet(id);
+    if (c) {
+        c->active = 1;
+        c->sleeping = 0;
+        c->still = 0;
+    }
+}
+
+//refresh an entry's extent from its collider. return 1 if the collider has been erased or made static
+static int egSweepRefresh(void * entry, void * ctx)
+{
+    egSweepEntry * e = entry;
+    egCollider * c = egCollidersGet(colliders, e->id);
+    (void)ctx;
+    if (c == 0 || c->body == EG_COLLIDER_STATIC) {
+        return 1;
+    }
+    e->min = c->position.x - c->width;
+    e->max = c->position.x + c->width;
+    e->min_y = c->position.y - c->height;
+    e->max_y = c->position.y + c->height;
+    e->type = c->type;
+    e->awake = egColliderAwake(c);
+    return 0;
+}
+
+static int egSweepComp(const void * a, const void * b, void * ctx)
+{
+    float x = ((const egSweepEntry*)a)->min, y = ((const egSweepEntry*)b)->min;
+    (void)ctx;
+    return (x > y) - (x < y);
+}
+
+static void egCollidersSweepUpdate(void)
+{
+    egHandle * pending = sweepPending.elements;
+    egSweepEntry * e, temp;
+    size_t i, j, added = 0, cursor;
+    egCollider * c;
+
+    if (sweepRebuild) {
+        eg_vec_clear(&sweep);
+        eg_vec_clear(&sweepPending);
+        cursor = egMemPoolFirst(colliders);
+        while ((c = egCollidersNext(colliders, &cursor))) {
+            if (c->body == EG_COLLIDER_STATIC) {
+                continue;
+            }
+            pending = eg_vec_emplace(&sweepPending);
+            if (pending == 0) {
+                //try again next tick
+                eg_vec_clear(&sweepPending);
+                return;
+            }
+            *pending = c->id;
+        }
+        pending = sweepPending.elements;
+        sweepRebuild = 0;
+    }
+
+    //drop erased colliders and update the rest in one pass
+    eg_vec_remove_if(&sweep, egSweepRefresh, 0);
+
+    for (i = 0; i < sweepPending.element_count; ++i) {
+        e = eg_vec_emplace(&sweep);
+        if (e == 0) {
+            //out of memory, the rest can try again next tick
+            eg_vec_erase_range(&sweepPending, 0, i);
+            return;
+        }
+        e->id = pending[i];
+        if (egSweepRefresh(e, 0)) {
+            //made and erased since the last tick
+            --sweep.element_count;
+        } else {
+            ++added;
+        }
+    }
+    eg_vec_clear(&sweepPending);
+
+    e = sweep.elements;
+    if (added > 64 && added > sweep.element_count / 16) {
+        //new entries start at the back and could be anywhere, so a big batch of them is cheaper to sort properly
+        eg_sort(e, sweep.element_count, sizeof(egSweepEntry), egSweepComp, 0);
+        return;
+    }
+    for (i = 1; i < sweep.element_count; ++i) {
+        if (e[i - 1].min <= e[i].min) {
+            continue;
+        }
+        temp = e[i];
+        for (j = i; j > 0 && e[j - 1].min > temp.min; --j) {
+            e[j] = e[j - 1];
+        }
+        e[j] = temp;
+    }
+}
+
+//test a candidate pair and add it to the contacts if it overlaps
+static void egCollidersTest(egHandle a, egHandle b)
+{
+    egCollider * cur, * cmp;
+    egHandle swap;
+    egSortKey64 * contact;
+
+    if (egHandleIndex(b) < egHandleIndex(a)) {
+        swap = a;
+        a = b;
+        b = swap;
+    }
+    cur = egCollidersGet(colliders, a);
+    cmp = egCollidersGet(colliders, b);
+    if (cur && cmp && cur->active && cmp->active && egCollidersCollides(cur->type, cmp->type) &&
+            (egColliderAwake(cur) || egColliderAwake(cmp)) &&
+            fabs(cur->position.x - cmp->position.x) < (cur->width + cmp->width) &&
+            fabs(cur->position.y - cmp->position.y) < (cur->height + cmp->height)) {
+        contact = eg_vec_emplace(&contacts);
+        if (contact) {
+            contact->key = ((uint64_t)a << 32) | b;
+            contact->value = ((uint64_t)cur->type << 32) | cmp->type;
+        }
+    }
+}
+
+//order preserving cell key: the cell's x in the high half and y in the low, offset so negative cells sort first
+static uint64_t egGridKey(int32_t x, int32_t y)
+{
+    return ((uint64_t)((uint32_t)x ^ 0x80000000u) << 32) | ((uint32_t)y ^ 0x80000000u);
+}
+
+//pair a collider too big for the grid with the colliders the tree finds around it
+static int egCollidersTreeFound(egHandle id, void * ctx)
+{
+    if (id != *(egHandle*)ctx) {
+        egCollidersTest(*(egHandle*)ctx, id);
+    }
+    return 1;
+}
+
+static void egCollidersTreeTick(void);
+
+static void egCollidersGridTick(void)
+{
+    float inv = 1.0f / cellSize, x0, y0, x1, y1;
+    size_t cursor, keys = 0, i, j, k, run;
+    int32_t x, y;
+    egCollider * c;
+    egGridItem * item, * a, * b;
+    egSortKey64 * key;
+
+    //the grid doesn't use the sweep queue
+    eg_vec_clear(&sweepPending);
+    eg_vec_clear(&gridItems);
+    eg_vec_clear(&gridKeys);
+
+    cursor = egMemPoolFirst(colliders);
+    while ((c = egCollidersNext(colliders, &cursor))) {
+        if (!c->active || c->body == EG_COLLIDER_STATIC) {
+            continue;
+        }
+        x0 = floorf((c->position.x - c->width) * inv);
+        y0 = floorf((c->position.y - c->height) * inv);
+        x1 = floorf((c->position.x + c->width) * inv);
+        y1 = floorf((c->position.y + c->height) * inv);
+        //written so nan fails it too. past the cap, or outside what a cell index can hold, the collider isn't
+        //put in the grid and finds its pairs in the tree, which also pairs it with other oversized ones
+        if (!(x0 >= -2147483648.0f && y0 >= -2147483648.0f && x1 < 2147483648.0f && y1 < 2147483648.0f &&
+                (x1 - x0 + 1.0f) * (y1 - y0 + 1.0f) <= EG_COLLIDER_GRID_MAX_CELLS)) {
+            egBVHQuery(&tree, egColliderBox(c), egCollidersTreeFound, &c->id);
+            continue;
+        }
+        item = eg_vec_emplace(&gridItems);
+        if (item == 0) {
+            //a grid missing colliders would end their contacts, so pair everything from the tree this tick
+            egCollidersTreeTick();
+            return;
+        }
+        item->id = c->id;
+        item->type = c->type;
+        item->awake = egColliderAwake(c);
+        item->x0 = (int32_t)x0;
+        item->y0 = (int32_t)y0;
+        item->x1 = (int32_t)x1;
+        item->y1 = (int32_t)y1;
+        keys += (size_t)(item->x1 - item->x0 + 1) * (size_t)(item->y1 - item->y0 + 1);
+    }
 
-                if (cmp->collision) {
-                    cmp->collision(cmp, cur);
+    key = eg_vec_emplace_n(&gridKeys, keys);
+    if (key == 0 || (gridScratch.alloc_size < keys && !eg_vec_resize(&gridScratch, keys))) {
+        egCollidersTreeTick();
+        return;
+    }
+    item = gridItems.elements;
+    for (i = 0; i < gridItems.element_count; ++i) {
+        for (x = item[i].x0; x <= item[i].x1; ++x) {
+            for (y = item[i].y0; y <= item[i].y1; ++y) {
+                key->key = egGridKey(x, y);
+                key->value = i;
+                ++key;
+            }
+        }
+    }
+    key = gridKeys.elements;
+    eg_radix_sort64(key, keys, gridScratch.elements);
+
+    //test every pair sharing a cell. a pair that shares several cells is only tested in the one holding the
+    //min corner of where their cell ranges overlap, which is always one of the cells they share
+    for (i = 0; i < keys; i += run) {
+        for (run = 1; i + run < keys && key[i + run].key == key[i].key; ++run) {
+        }
+        if (run < 2) {
+            continue;
+        }
+        x = (int32_t)((uint32_t)(key[i].key >> 32) ^ 0x80000000u);
+        y = (int32_t)((uint32_t)key[i].key ^ 0x80000000u);
+        for (j = i; j < i + run; ++j) {
+            a = &item[key[j].value];
+            for (k = j + 1; k < i + run; ++k) {
+                b = &item[key[k].value];
+                if ((a->awake || b->awake) && egCollidersCollides(a->type, b->type) && ((a->x0 > b->x0) ? a->x0 : b->x0) == x && ((a->y0 > b->y0) ? a->y0 : b->y0) == y) {
+                    egCollidersTest(a->id, b->id);
                 }
             }
-            cmp = (egCollider*)egMemPoolNext(colliders, &id2);
         }
-        cur = (egCollider*)egMemPoolNext(colliders, &id1);
     }
 }
+
+void egCollidersRefit(void)
+{
+    size_t cursor = egMemPoolFirst(colliders);
+    egCollider * c;
+    while ((c = egCollidersNext(colliders, &cursor))) {
+        if (c->body == EG_COLLIDER_STATIC) {
+            continue;
+        }
+        if (c->position.x != c->last.x || c->position.y != c->last.y) {
+            c->last = c->position;
+            c->still = 0;
+            c->sleeping = 0;
+        } else if (sleepTicks && c->body == EG_COLLIDER_DYNAMIC && !c->sleeping && ++c->still >= sleepTicks) {
+            c->sleeping = 1;
+        }
+        if (!c->sleeping) {
+            egBVHMove(&tree, c->proxy, egColliderBox(c));
+        }
+    }
+}
+
+typedef struct egColliderQuery {
+    egAABB box;
+    egHandle * ids;
+    size_t count, max;
+} egColliderQuery;
+
+static int egCollidersQueryFound(egHandle id, void * ctx)
+{
+    egColliderQuery * q = ctx;
+    egCollider * c = egCollidersGet(colliders, id);
+    //the tree only knows fat boxes
+    if (c->active && egAABBOverlap(q->box, egColliderBox(c))) {
+        if (q->count < q->max) {
+            q->ids[q->count] = id;
+        }
+        ++q->count;
+    }
+    return 1;
+}
+
+size_t egCollidersQuery(egV2 min, egV2 max, egHandle * ids, size_t max_ids)
+{
+    egColliderQuery q;
+    q.box.min = min;
+    q.box.max = max;
+    q.ids = ids;
+    q.count = 0;
+    q.max = max_ids;
+    egBVHQuery(&tree, q.box, egCollidersQueryFound, &q);
+    egBVHQuery(&staticTree, q.box, egCollidersQueryFound, &q);
+    return q.count;
+}
+
+typedef struct egColliderRay {
+    egV2 from, to;
+    egHandle id;
+    float fraction;
+} egColliderRay;
+
+static float egCollidersRayHit(egHandle id, float max_fraction, void * ctx)
+{
+    egColliderRay * r = ctx;
+    egCollider * c = egCollidersGet(colliders, id);
+    float f;
+    if (!c->active) {
+        return max_fraction;
+    }
+    f = egAABBRay(egColliderBox(c), r->from, r->to);
+    //r->fraction carries the nearest hit over from the other tree
+    if (f < 0.0f || f >= r->fraction) {
+        return max_fraction;
+    }
+    r->id = id;
+    r->fraction = f;
+    return f;
+}
+
+egHandle egCollidersRaycast(egV2 from, egV2 to, float * fraction)
+{
+    egColliderRay r;
+    r.from = from;
+    r.to = to;
+    r.id = EG_HANDLE_NONE;
+    r.fraction = 1.0f;
+    egBVHRaycast(&staticTree, from, to, egCollidersRayHit, &r);
+    egBVHRaycast(&tree, from, to, egCollidersRayHit, &r);
+    if (fraction) {
+        *fraction = r.fraction;
+    }
+    return r.id;
+}
+
+static void egCollidersTreePair(egHandle a, egHandle b, void * ctx)
+{
+    (void)ctx;
+    egCollidersTest(a, b);
+}
+
+static int egCollidersStaticPair(egHandle id, void * ctx)
+{
+    egCollidersTest(*(egHandle*)ctx, id);
+    return 1;
+}
+
+static void egCollidersTreeTick(void)
+{
+    //the tree doesn't use the sweep queue
+    eg_vec_clear(&sweepPending);
+    egBVHQueryPairs(&tree, egCollidersTreePair, 0);
+}
+
+//add a pair of entry i and entry j + k for every bit k set in hits
+static void egSweepEmit(size_t i, size_t j, uint64_t hits)
+{
+    egSweepPair * p;
+    while (hits) {
+        p = eg_vec_emplace(&sweepPairs);
+        if (p == 0) {
+            return;
+        }
+        p->a = i;
+        p->b = j + egMemCtz64(hits);
+        hits &= hits - 1;
+    }
+}
+
+//find the entries after i whose boxes overlap its box. entries are sorted by min x, so everything that can overlap
+//i on x comes straight after it, and they only have to be checked on y. the first one starting past i's max x ends it
+static void egSweepOverlaps(const float * min_x, const float * min_y, const float * max_y, size_t i, float right, size_t count)
+{
+    size_t j = i + 1;
+    float bottom = min_y[i], top = max_y[i];
+#if defined(__AVX__)
+    __m256 r = _mm256_set1_ps(right), b = _mm256_set1_ps(bottom), t = _mm256_set1_ps(top), x, y;
+    for (; j + 8 <= count; j += 8) {
+        x = _mm256_cmp_ps(_mm256_loadu_ps(min_x + j), r, _CMP_LE_OQ);
+        y = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(min_y + j), t, _CMP_LE_OQ), _mm256_cmp_ps(_mm256_loadu_ps(max_y + j), b, _CMP_GE_OQ));
+        egSweepEmit(i, j, _mm256_movemask_ps(_mm256_and_ps(x, y)));
+        if (_mm256_movemask_ps(x) != 0xff) {
+            return;
+        }
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 r = _mm_set1_ps(right), b = _mm_set1_ps(bottom), t = _mm_set1_ps(top), x, y;
+    for (; j + 4 <= count; j += 4) {
+        x = _mm_cmple_ps(_mm_loadu_ps(min_x + j), r);
+        y = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(min_y + j), t), _mm_cmpge_ps(_mm_loadu_ps(max_y + j), b));
+        egSweepEmit(i, j, _mm_movemask_ps(_mm_and_ps(x, y)));
+        if (_mm_movemask_ps(x) != 0xf) {
+            return;
+        }
+    }
+#endif
+    for (; j < count && min_x[j] <= right; ++j) {
+        if (min_y[j] <= top && max_y[j] >= bottom) {
+            egSweepEmit(i, j, 1);
+        }
+    }
+}
+
+static void egCollidersSweepTick(void)
+{
+    egSweepEntry * e;
+    egSweepPair * p;
+    float * min_x, * max_x, * min_y, * max_y;
+    size_t count, i;
+
+    egCollidersSweepUpdate();
+
+    e = sweep.elements;
+    count = sweep.element_count;
+    if (sweepBounds.alloc_size < count && !eg_soa_resize(&sweepBounds, count)) {
+        return;
+    }
+    sweepBounds.element_count = count;
+    min_x = eg_soa_data(&sweepBounds, EG_SWEEP_MIN_X);
+    max_x = eg_soa_data(&sweepBounds, EG_SWEEP_MAX_X);
+    min_y = eg_soa_data(&sweepBounds, EG_SWEEP_MIN_Y);
+    max_y = eg_soa_data(&sweepBounds, EG_SWEEP_MAX_Y);
+    for (i = 0; i < count; ++i) {
+        min_x[i] = e[i].min;
+        max_x[i] = e[i].max;
+        min_y[i] = e[i].min_y;
+        max_y[i] = e[i].max_y;
+    }
+
+    eg_vec_clear(&sweepPairs);
+    for (i = 0; i < count; ++i) {
+        egSweepOverlaps(min_x, min_y, max_y, i, max_x[i], count);
+    }
+
+    p = sweepPairs.elements;
+    count = sweepPairs.element_count;
+    for (i = 0; i < count; ++i) {
+        //filter on what's copied into the entries, to skip looking the colliders up
+        if ((e[p[i].a].awake || e[p[i].b].awake) && egCollidersCollides(e[p[i].a].type, e[p[i].b].type)) {
+            egCollidersTest(e[p[i].a].id, e[p[i].b].id);
+        }
+    }
+}
+
+//pairs of an awake collider and a static one
+static void egCollidersStaticTick(void)
+{
+    size_t cursor;
+    egCollider * c;
+
+    if (staticTree.root == EG_BVH_NULL) {
+        return;
+    }
+    cursor = egMemPoolFirst(colliders);
+    while ((c = egCollidersNext(colliders, &cursor))) {
+        if (c->active && egColliderAwake(c)) {
+            egBVHQuery(&staticTree, egColliderBox(c), egCollidersStaticPair, &c->id);
+        }
+    }
+}
+
+static void egCollidersContactEvent(int event, uint64_t key)
+{
+    egContact * c = eg_vec_emplace(&contactEvents[event]);
+    if (c) {
+        c->a = key >> 32;
+        c->b = (egHandle)key;
+    }
+}
+
+//sort this tick's contacts and walk them alongside last tick's
+static void egCollidersContactEvents(void)
+{
+    egSortKey64 * cur, * last = lastContacts.elements;
+    size_t count, last_count = lastContacts.element_count, i, j, k;
+
+    for (i = 0; i < EG_CONTACT_EVENTS; ++i) {
+        eg_vec_clear(&contactEvents[i]);
+    }
+    count = contacts.element_count;
+    if (contactScratch.alloc_size < count && !eg_vec_resize(&contactScratch, count)) {
+        //without them sorted there's nothing to diff, so no events this tick
+        eg_vec_clear(&contacts);
+        return;
+    }
+    cur = contacts.elements;
+    eg_radix_sort64(cur, count, contactScratch.elements);
+
+    //a broadphase finds each pair once, but keep the list a set whatever finds them
+    for (i = k = 0; i < count; ++i) {
+        if (k == 0 || cur[i].key != cur[k - 1].key) {
+            cur[k++] = cur[i];
+        }
+    }
+    contacts.element_count = count = k;
+
+    i = j = 0;
+    while (i < count || j < last_count) {
+        if (j == last_count || (i < count && cur[i].key < last[j].key)) {
+            egCollidersContactEvent(EG_CONTACT_BEGIN, cur[i++].key);
+        } else if (i == count || last[j].key < cur[i].key) {
+            egCollidersContactEvent(EG_CONTACT_END, last[j++].key);
+        } else {
+            egCollidersContactEvent(EG_CONTACT_STAY, cur[i++].key);
+            ++j;
+        }
+    }
+}
+
+//call both callbacks for every contact, lower index first. a callback can erase or deactivate either
+//collider, so both are looked up again before each call
+static void egCollidersDispatch(void)
+{
+    egSortKey64 * contact = contacts.elements, * order;
+    size_t count = contacts.element_count, i;
+    egHandle a, b;
+    egCollider * cur, * cmp;
+
+    if (dispatchByType && count > 1 && contactScratch.alloc_size >= 2 * count) {
+        //the scratch holds the contacts keyed by type, then room for the sort. radix sorting is stable,
+        //so each run of one pair of types stays in handle order
+        order = contactScratch.elements;
+        for (i = 0; i < count; ++i) {
+            order[i].key = contact[i].value;
+            order[i].value = contact[i].key;
+        }
+        eg_radix_sort64(order, count, order + count);
+    } else {
+        order = 0;
+    }
+
+    for (i = 0; i < count; ++i) {
+        if (order) {
+            a = order[i].value >> 32;
+            b = (egHandle)order[i].value;
+        } else {
+            a = contact[i].key >> 32;
+            b = (egHandle)contact[i].key;
+        }
+        cur = egCollidersGet(colliders, a);
+        cmp = egCollidersGet(colliders, b);
+        if (cur && cmp && cur->active && cmp->active && cur->collision) {
+            cur->collision(cur, cmp);
+            cur = egCollidersGet(colliders, a);
+            cmp = egCollidersGet(colliders, b);
+        }
+        if (cur && cmp && cur->active && cmp->active && cmp->collision) {
+            cmp->collision(cmp, cur);
+        }
+    }
+}
+
+void egCollidersSetDispatchByType(int by_type)
+{
+    dispatchByType = by_type;
+}
+
+const egContact * egCollidersContacts(int event, size_t * count)
+{
+    if (event < 0 || event >= EG_CONTACT_EVENTS) {
+        *count = 0;
+        return 0;
+    }
+    *count = contactEvents[event].element_count;
+    return contactEvents[event].elements;
+}
+
+void egCollidersTick(void)
+{
+    egVec swap;
+
+    egCollidersRefit();
+    eg_vec_clear(&contacts);
+
+    if (broadphase == EG_BROADPHASE_TREE) {
+        egCollidersTreeTick();
+    } else if (broadphase == EG_BROADPHASE_GRID) {
+        egCollidersGridTick();
+    } else {
+        egCollidersSweepTick();
+    }
+    egCollidersStaticTick();
+
+    egCollidersContactEvents();
+    if (dispatchByType && contactScratch.alloc_size < 2 * contacts.element_count) {
+        //falls back to handle order if this fails
+        eg_vec_resize(&contactScratch, 2 * contacts.element_count);
+    }
+    egCollidersDispatch();
+
+    swap = lastContacts;
+    lastContacts = contacts;
+    contacts = swap;
+}
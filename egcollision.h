@@ -28,22 +28,125 @@ THE SOFTWARE.
 typedef struct egCollider {
     egV2 position;
     float width, height;
-    uint32_t type, id, oid;
+    uint32_t type;
+    egHandle id;
+    uint32_t oid;
     void * userdata;
+    //the collider's leaf in the collision tree, see egbvh.h
+    int32_t proxy;
     uint16_t (*collision)(struct egCollider *, struct egCollider *);
     uint16_t active;
+    //see egColliderSetBody and egCollidersSetSleepTicks
+    uint16_t body, sleeping;
+    uint32_t still;
+    egV2 last;
 } egCollider;
 
+//inline access to the collider pool, see EG_MEM_POOL_TYPED
+EG_MEM_POOL_TYPED(egColliders, egCollider)
+
 void egCollidersInit(void);
 
 uint32_t egColliderCount();
 egMemPool egColliderPool();
 
-uint32_t egColliderNew(float x, float y, float w, float h, uint32_t type, uint16_t (*collision)(egCollider *, egCollider *), void * userdata, uint32_t oid);
-egCollider * egColliderGet(uint32_t id);
-void egColliderErase(uint32_t id);
+//collider ids are egHandles: once a collider is erased, egColliderGet on its id returns null.
+//egColliderNew returns EG_HANDLE_NONE if the collider pool can't grow
+egHandle egColliderNew(float x, float y, float w, float h, uint32_t type, uint16_t (*collision)(egCollider *, egCollider *), void * userdata, uint32_t oid);
+
+//create count colliders of one size and type at positions[i], with userdata[i] (or none if userdata is null).
+//their ids go to ids. return count, or 0 if the pool couldn't grow
+size_t egColliderNewBatch(size_t count, const egV2 * positions, float w, float h, uint32_t type, uint16_t (*collision)(egCollider *, egCollider *), void * const * userdata, uint32_t oid, egHandle * ids);
+egCollider * egColliderGet(egHandle id);
+//return 1 if the collider was erased, 0 if id is stale or it couldn't be, see egMemPoolErase
+int egColliderErase(egHandle id);
+
+//collider types work as layers: a pair is only tested if its types collide, checked before the box test.
+//every type collides with every type to start with. only types below EG_COLLIDER_TYPES can be filtered,
+//colliders of higher types always collide
+#define EG_COLLIDER_TYPES 32
+
+void egCollidersSetCollides(uint32_t a, uint32_t b, int collides);
+int egCollidersCollides(uint32_t a, uint32_t b);
+//type collides with the types whose bits are set in mask, and only those
+void egCollidersSetMask(uint32_t type, uint32_t mask);
+
+//how a collider moves. pairs where neither collider is awake, meaning a kinematic collider or a dynamic one
+//that isn't sleeping, are skipped. new colliders are dynamic
+enum egColliderBody {
+    EG_COLLIDER_DYNAMIC = 0,
+    //never moves. statics live in their own tree, which isn't refit, so move one by making it dynamic first
+    EG_COLLIDER_STATIC,
+    //moved by the game, never sleeps
+    EG_COLLIDER_KINEMATIC
+};
+
+//return 0 if id is stale, body isn't an egColliderBody or out of memory. the collider keeps its old body then
+int egColliderSetBody(egHandle id, int body);
+
+//dynamic colliders that haven't moved for this many ticks go to sleep until they move or are woken.
+//0, the default, means they never sleep
+void egCollidersSetSleepTicks(uint32_t ticks);
+void egColliderWake(egHandle id);
+
+void egColliderDeactivate(egHandle id);
+void egColliderActivate(egHandle id);
+
+//how egCollidersTick finds candidate pairs. every pair still gets the exact test before its callbacks are called
+enum egBroadphase {
+    //sweep and prune on x. good for mixed sizes and coherent motion
+    EG_BROADPHASE_SWEEP = 0,
+    //uniform grid of cell_size squares. good for lots of colliders about one cell across or smaller,
+    //a collider costs one entry for every cell it touches. colliders touching more than EG_COLLIDER_GRID_MAX_CELLS
+    //cells are paired through the collision tree instead
+    EG_BROADPHASE_GRID,
+    //pairs from the collision tree. good for widely varying sizes and sparse scenes
+    EG_BROADPHASE_TREE
+};
+
+#define EG_COLLIDER_CELL_SIZE 32.0f
+#define EG_COLLIDER_GRID_MAX_CELLS 64
+//how far past its box a collider can move before its leaf in the collision tree has to be moved
+#define EG_COLLIDER_FAT_MARGIN 4.0f
+
+//cell_size is only used by the grid, zero keeps the current one
+void egCollidersSetBroadphase(int broadphase, float cell_size);
+
+//every collider is kept in a bounding volume tree whatever the broadphase, for the queries below.
+//the tree follows the colliders' positions at the start of each tick, or when egCollidersRefit is called.
+//this is also when dynamic colliders that have moved wake up
+void egCollidersRefit(void);
+
+//find the active colliders overlapping the box min..max. up to max_ids of their ids go to ids.
+//return how many there are in total
+size_t egCollidersQuery(egV2 min, egV2 max, egHandle * ids, size_t max_ids);
+
+//find the nearest active collider the segment from -> to hits, or EG_HANDLE_NONE. if fraction isn't null it gets
+//how far along the segment the hit is, from 0 to 1
+egHandle egCollidersRaycast(egV2 from, egV2 to, float * fraction);
+
+//egCollidersTick finds every overlapping pair before calling any callbacks, so the callbacks see the contacts
+//as of the end of detection. by default they're called in order of the pair's handles, lower index first.
+//by_type groups the calls by the pair's types instead, so each kind of callback runs back to back
+void egCollidersSetDispatchByType(int by_type);
+
+//a pair of colliders in contact, a has the lower handle index
+typedef struct egContact {
+    egHandle a, b;
+} egContact;
+
+enum egContactEvent {
+    //touching this tick but not the last
+    EG_CONTACT_BEGIN = 0,
+    //touching both ticks
+    EG_CONTACT_STAY,
+    //touching last tick but not this one. either collider may have been erased since.
+    //pairs that are no longer tested, because both sleep or one was deactivated, end too
+    EG_CONTACT_END,
+    EG_CONTACT_EVENTS
+};
 
-void egColliderDeactivate(uint32_t id);
-void egColliderActivate(uint32_t id);
+//the pairs with event on the last tick, sorted by handle. valid until the next tick
+const egContact * egCollidersContacts(int event, size_t * count);
 
 void egCollidersTick(void);
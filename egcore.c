@@ -50,13 +50,24 @@ void egCoreSetFrameDelay(unsigned int delay)
 void egControlModeCreate(const char name[16])
 {
     egMap m = eg_map_new(0, sizeof(int), sizeof(egButtonMapping), iCmp);
-    buttons = eg_map_insert(&buttonContexts, name, &m);
+    egAtom atom = egAtomIntern(name);
+    //recreating a mode replaces it, so free the old mappings first
+    egMap * old = eg_map_get(&buttonContexts, &atom, 0);
+    if (old) {
+        eg_map_free(old);
+    }
+    buttons = eg_map_insert(&buttonContexts, &atom, &m);
     //buttons = eg_vec_at(&buttonContexts.values,ofs);
 }
 
 void egControlModeSet(const char name[16])
 {
-    buttons = eg_map_get(&buttonContexts, name, 0);
+    egControlModeSetAtom(egAtomFind(name));
+}
+
+void egControlModeSetAtom(egAtom name)
+{
+    buttons = eg_map_get(&buttonContexts, &name, 0);
 }
 
 size_t egButtonPressed(int button, void (*key)(void*), void * data)
@@ -83,16 +94,12 @@ size_t egButtonReleased(int button, void (*key)(void*), void * data)
     return nextbutton++;
 }
 
-int egCSstrcmp(const void * a, const void * b){
-	return strcmp( (const char*)a, (const char*)b);
-}
-
 void egCoreStart(void)
 {
     egMemInit();
     eg_initmodels();
     egCollidersInit();
-    buttonContexts = eg_map_new(1, sizeof(char) * 16, sizeof(egMap), egCSstrcmp);
+    buttonContexts = eg_map_new_hash(1, sizeof(egAtom), sizeof(egMap), egAtomCmp, egAtomHash);
 }
 
 void egCoreTick(void)
@@ -129,6 +136,7 @@ void egCoreTick(void)
 
     egCollidersTick();
     egRendererRender();
+    egMemFrameEnd();
 
     SDL_Delay(framedelay);
 }
@@ -140,5 +148,6 @@ void egCoreEnd(void)
     }
     eg_map_free(&buttonContexts);
     eg_shutdownmodels();
+    egAtomsDeInit();
     egMemDeInit();
 }
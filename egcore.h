@@ -22,6 +22,7 @@ THE SOFTWARE.
 #pragma once
 
 #include <stddef.h>
+#include "egatom.h"
 
 extern short EG_RUNNING;
 
@@ -29,6 +30,7 @@ void egCoreSetFrameDelay(unsigned int delay);
 
 void egControlModeCreate(const char[16]);
 void egControlModeSet(const char[16]);
+void egControlModeSetAtom(egAtom name);
 
 size_t egButtonPressed(int button, void (*key)(void*), void * data);
 size_t egButtonReleased(int button, void (*key)(void*), void * data);
@@ -36,4 +38,4 @@ void egButtonUnmap(size_t buttonid);
 
 void egCoreStart(void);
 void egCoreTick(void);
-void egCoreEnd(void);
\ No newline at end of file
+void egCoreEnd(void);
\ No newline at end of file
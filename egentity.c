@@ -30,22 +30,36 @@ THE SOFTWARE.
 egMemPool entityPool = 0;
 
 
-unsigned int egEntNew(egV3 position, egQuat rotation, char model[16], char texture[16])
+static void egEntPoolInit(void)
 {
     if (entityPool == 0) {
 
-        egMemPoolNew(&entityPool, sizeof(egEntity), 16);
+        egEntitiesNew(&entityPool, 16, EG_MEMPOOL_PACKED | EG_MEMPOOL_CHUNKED);
+        egMemPoolSetTag(entityPool, "entities");
     }
+}
+
+egHandle egEntNew(egV3 position, egQuat rotation, char model[16], char texture[16])
+{
+    return egEntNewAtom(position, rotation, egAtomFind(model), egAtomIntern(texture));
+}
+
+egHandle egEntNewAtom(egV3 position, egQuat rotation, egAtom model, egAtom texture)
+{
+    egEntPoolInit();
 
     //printf("new entity %s %s\n", model, texture);
 
-    size_t id;
+    egHandle id;
     egEntity * e;
     //printf("initializing entity\n");
     egMemPoolAlloc(entityPool, (void*)&e, &id);
+    if (e == 0) {
+        return EG_HANDLE_NONE;
+    }
 
-    e->model = egModelGet(model);
-    e->texid = egRendererGetTexid(texture);
+    e->model = egModelGetAtom(model);
+    e->texid = egRendererGetTexidAtom(texture);
     e->position = position;
     e->rotation = rotation;
 
@@ -53,16 +67,44 @@ unsigned int egEntNew(egV3 position, egQuat rotation, char model[16], char textu
     return id;
 }
 
-void egEntErase(unsigned int id)
+size_t egEntNewBatch(size_t count, const egV3 * positions, const egQuat * rotations, char model[16], char texture[16], egHandle * ids)
+{
+    egMemArenaMarker mark;
+    egEntity ** ents;
+    egModel * m;
+    unsigned int texid;
+    size_t made = 0;
+
+    egEntPoolInit();
+    mark = egMemArenaMark(egMemFrameArena());
+    ents = egMemArenaAlloc(egMemFrameArena(), count * sizeof(egEntity*), sizeof(egEntity*));
+    if (ents) {
+        made = egMemPoolAllocN(entityPool, count, (void**)ents, ids);
+    }
+
+    if (made) {
+        //the whole batch shares a model and texture, so look them up once
+        m = egModelGet(model);
+        texid = egRendererGetTexid(texture);
+        for (size_t i = 0; i < made; ++i) {
+            ents[i]->model = m;
+            ents[i]->texid = texid;
+            ents[i]->position = positions[i];
+            ents[i]->rotation = rotations[i];
+        }
+    }
+    egMemArenaRollback(egMemFrameArena(), mark);
+    return made;
+}
+
+int egEntErase(egHandle id)
 {
-    egMemPoolErase(entityPool, id);
+    return egMemPoolErase(entityPool, id);
 }
 
-egEntity * egEntGet(unsigned int id)
+egEntity * egEntGet(egHandle id)
 {
-    egEntity * ent = 0;
-    egMemPoolGetP(entityPool, (void*)&ent, id);
-    return ent;
+    return egEntitiesGet(entityPool, id);
 }
 
 egMemPool egEntPool(void)
@@ -33,8 +33,19 @@ typedef struct egEntity {
     unsigned int texid;
 } egEntity;
 
+//inline access to the entity pool, see EG_MEM_POOL_TYPED
+EG_MEM_POOL_TYPED(egEntities, egEntity)
 
-unsigned int egEntNew(egV3 position, egQuat rotation, char model[16], char texture[16]);
-void egEntErase(unsigned int id);
-egEntity * egEntGet(unsigned int id);
+
+//entity ids are egHandles: once an entity is erased, egEntGet on its id returns null.
+//egEntNew returns EG_HANDLE_NONE if the entity pool can't grow
+egHandle egEntNew(egV3 position, egQuat rotation, char model[16], char texture[16]);
+egHandle egEntNewAtom(egV3 position, egQuat rotation, egAtom model, egAtom texture);
+
+//spawn count entities sharing a model and texture, at positions[i] and rotations[i]. their ids go to ids.
+//return count, or 0 if the pool couldn't grow
+size_t egEntNewBatch(size_t count, const egV3 * positions, const egQuat * rotations, char model[16], char texture[16], egHandle * ids);
+//return 1 if the entity was erased, 0 if id is stale or it couldn't be, see egMemPoolErase
+int egEntErase(egHandle id);
+egEntity * egEntGet(egHandle id);
 egMemPool egEntPool(void);
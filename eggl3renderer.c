@@ -205,14 +205,15 @@ unsigned int egGL3LoadTexture(const char * filename)
         return 0;
     PHYSFS_File * f = PHYSFS_openRead(filename);
     unsigned int result, fsize = PHYSFS_fileLength(f);
-    unsigned char * data = malloc(sizeof(char) * fsize);
+    egMemArenaMarker mark = egMemArenaMark(egMemFrameArena());
+    unsigned char * data = egMemArenaAlloc(egMemFrameArena(), sizeof(char) * fsize, 1);
 
     PHYSFS_read(f, data, sizeof(char), fsize);
 
     result = SOIL_load_OGL_texture_from_memory(data, fsize, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID, SOIL_FLAG_MIPMAPS);
 
     PHYSFS_close(f);
-    free(data);
+    egMemArenaRollback(egMemFrameArena(), mark);
     return result;//SOIL_load_OGL_texture(filename, SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID, SOIL_FLAG_MIPMAPS);
 }
 
@@ -224,8 +225,8 @@ void egGL3RenderEntities(void)
     egMesh * tmesh;
     egTriangle * ttri;
     egVertex * tvert;
-    size_t eid = egMemPoolFirst(entpool);
-    tentity = (egEntity*)egMemPoolNext(entpool, &eid);
+    //the entity pool is packed and chunked, so live entities are a few plain arrays
+    size_t ecount = egMemPoolCount(entpool), erun = 0;
 
     egMat4 tmat;
 
@@ -233,33 +234,35 @@ void egGL3RenderEntities(void)
     glEnableClientState(GL_VERTEX_ARRAY);
     glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 
-    while(tentity) {
-        //glGetFloatv(GL_MODELVIEW, (float*)&renderer.projection);
-        glPushMatrix();
-        //printf("%u\n", i);
-        //printf("%u %u\n", (size_t)tentity->model, tentity->texid);
-        tmodel = tentity->model;
-        tmat = egQuatMat4(tentity->rotation);
-        renderer.SetTexture(tentity->texid);
-
-        glTranslatef(tentity->position.x, tentity->position.y, tentity->position.z);
-        //egMat4Transpose(&tmat);
-        glMultMatrixf((float*)&tmat);
-
-
-
-        for (int j = 0; j < tmodel->meshes; ++j) {
-            tmesh = egMeshGet(tmodel->ofs_mesh) + j;
-            ttri = egTriGet(tmesh->ofs_tri);
-            tvert = egVertGet(tmesh->ofs_vert);
-
-            glVertexPointer(3, GL_FLOAT, sizeof(egVertex), (void*)&(tvert->position));
-            glTexCoordPointer(2, GL_FLOAT, sizeof(egVertex), (void*)&(tvert->texcoord));
-            glDrawElements(GL_TRIANGLES, tmesh->tris * 3, GL_UNSIGNED_INT, (void*)ttri);
+    for (size_t i = 0; i < ecount; i += erun) {
+        tentity = (egEntity*)egMemPoolRun(entpool, i, &erun);
+        for (size_t k = 0; k < erun; ++k, ++tentity) {
+            //glGetFloatv(GL_MODELVIEW, (float*)&renderer.projection);
+            glPushMatrix();
+            //printf("%u\n", i);
+            //printf("%u %u\n", (size_t)tentity->model, tentity->texid);
+            tmodel = tentity->model;
+            tmat = egQuatMat4(tentity->rotation);
+            renderer.SetTexture(tentity->texid);
+
+            glTranslatef(tentity->position.x, tentity->position.y, tentity->position.z);
+            //egMat4Transpose(&tmat);
+            glMultMatrixf((float*)&tmat);
+
+
+
+            for (int j = 0; j < tmodel->meshes; ++j) {
+                tmesh = egMeshGet(tmodel->ofs_mesh) + j;
+                ttri = egTriGet(tmesh->ofs_tri);
+                tvert = egVertGet(tmesh->ofs_vert);
+
+                glVertexPointer(3, GL_FLOAT, sizeof(egVertex), (void*)&(tvert->position));
+                glTexCoordPointer(2, GL_FLOAT, sizeof(egVertex), (void*)&(tvert->texcoord));
+                glDrawElements(GL_TRIANGLES, tmesh->tris * 3, GL_UNSIGNED_INT, (void*)ttri);
+            }
+            //glLoadMatrixf((float*)&renderer.projection);
+            glPopMatrix();
         }
-        //glLoadMatrixf((float*)&renderer.projection);
-        glPopMatrix();
-        tentity = (egEntity*)egMemPoolNext(entpool, &eid);
     }
     glDisableClientState(GL_VERTEX_ARRAY);
     glDisableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -281,7 +284,7 @@ void egGL3RenderColliders(void)
     float top, bottom, left, right;
 
     size_t id = egMemPoolFirst(colliders);
-    egCollider * c = (egCollider*)egMemPoolNext(colliders, &id);
+    egCollider * c = egCollidersNext(colliders, &id);
 
     glEnableClientState(GL_VERTEX_ARRAY);
     while (c) {
@@ -304,7 +307,7 @@ void egGL3RenderColliders(void)
         verts[3].y = left;
         glVertexPointer(3, GL_FLOAT, 0, verts);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, indices);
-        c = (egCollider*)egMemPoolNext(colliders, &id);
+        c = egCollidersNext(colliders, &id);
     }
     glDisableClientState(GL_VERTEX_ARRAY);
     //glDisable(GL_BLEND);
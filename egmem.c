@@ -21,11 +21,14 @@ THE SOFTWARE.
 */
 #include "egmem.h"
 #include <malloc.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <stdio.h>
 #include <signal.h>
 
 egMemPool memArrays = 0, memPools = 0;
+egMemArena frameArena = {0};
+egMemArenaDouble frameArenaDouble = {0};
 
 void egMemDeInit(void)
 {
@@ -48,13 +51,21 @@ void egMemDeInit(void)
 
     egMemPoolFree(memArrays);
     egMemPoolFree(memPools);
+
+    if (frameArena.block_size) {
+        egMemArenaFree(&frameArena);
+    }
+    if (frameArenaDouble.arenas[0].block_size) {
+        egMemArenaDoubleFree(&frameArenaDouble);
+    }
 }
 
 void egMemInit(void)
 {
     egMemPool a, b;
-    egMemPoolNew(&a, sizeof(egMemArrayData), 16);
-    egMemPoolNew(&b, sizeof(egMemPoolData), 16);
+    //callers hold pointers straight into these pools, so their storage must never move
+    egMemPoolNewEx(&a, sizeof(egMemArrayData), 16, EG_MEMPOOL_CHUNKED);
+    egMemPoolNewEx(&b, sizeof(egMemPoolData), 16, EG_MEMPOOL_CHUNKED);
     memArrays = a;
     memPools = b;
     //atexit(egMemDeInit); there/s a bug!
@@ -64,10 +75,10 @@ void egMemInit(void)
 void	egMemArrayNew(egMemArray * m, size_t object_size, size_t object_count)
 {
     egMemArray a;
-    size_t id;
+    egHandle id;
     if (memArrays == 0) {
         a = malloc(sizeof(egMemArrayData));
-        id = -1;
+        id = EG_HANDLE_NONE;
     } else {
         egMemPoolAlloc(memArrays, (void*)&a, &id);
     }
@@ -76,12 +87,46 @@ void	egMemArrayNew(egMemArray * m, size_t object_size, size_t object_count)
     a->object_size = object_size;
     a->object_count = 0;
     a->buffer_size = object_count * object_size;
+    a->growth = EG_MEM_GROW_GEOMETRIC;
+    a->growth_step = 100;
+    a->chunks = 0;
+    a->chunk_count = 0;
+    a->chunk_objects = 0;
+    a->chunk_shift = 0;
+    a->tag = 0;
+    a->peak_bytes = a->buffer_size;
+    a->resizes = 0;
+    a->reallocs = 0;
     a->id = id;
     *m = a;
 }
+
+void	egMemArrayNewChunked(egMemArray * m, size_t object_size, size_t chunk_size)
+{
+    egMemArray a;
+    size_t shift = 0;
+    egMemArrayNew(&a, object_size, 0);
+    free(a->data);
+    a->data = 0;
+    a->buffer_size = 0;
+    //largest power of two number of objects that fits the chunk, so GetP can shift and mask
+    while ((object_size << (shift + 1)) <= chunk_size) {
+        ++shift;
+    }
+    a->chunk_shift = shift;
+    a->chunk_objects = (size_t)1 << shift;
+    *m = a;
+}
+
 void	egMemArrayFree(egMemArray m)
 {
+    for (size_t i = 0; i < m->chunk_count; ++i) {
+        free(m->chunks[i]);
+    }
+    free(m->chunks);
     free(m->data);
+    m->chunks = 0;
+    m->chunk_count = 0;
     m->object_count = 0;
     m->object_size = 0;
     m->buffer_size = 0;
@@ -98,11 +143,22 @@ void	egMemArrayClear(egMemArray m)
 }
 
 //copy the value pointed to by data to the back of m, allocate space for it if needed
-void	egMemArrayPush(egMemArray m, const void * data)
+int		egMemArrayPush(egMemArray m, const void * data)
 {
     void * target;
     egMemArrayAlloc(m, &target, 1);
+    if (target == 0) {
+        return 0;
+    }
     memcpy(target, data, m->object_size);
+    return 1;
+}
+
+//add one object to the back of m and point data at it, or at 0 if out of memory
+void	egMemArrayEmplace(egMemArray m, void ** data)
+{
+    //a single object never straddles chunks, so this can't fail for that reason
+    egMemArrayAlloc(m, data, 1);
 }
 
 //pop the back of m as a stack, return 0 if empty, copies returned value to data on success. shrinks the array by one.
@@ -136,10 +192,31 @@ int		egMemArrayGet(egMemArray m, void * data, size_t index)
 //return the address of the element at index.
 void	egMemArrayGetP(egMemArray m, void ** data, size_t index)
 {
-    if (index < m->object_count) {
-        *data = &(m->data)[index * m->object_size];
-    } else {
+    if (index >= m->object_count) {
         *data = 0;
+    } else if (m->chunk_objects) {
+        *data = &(m->chunks[index >> m->chunk_shift])[(index & (m->chunk_objects - 1)) * m->object_size];
+    } else {
+        *data = &(m->data)[index * m->object_size];
+    }
+}
+
+//close the gap at index one chunk at a time, carrying the first object of each following chunk back into the one before
+static void egMemArrayEraseChunked(egMemArray m, size_t index)
+{
+    size_t mask = m->chunk_objects - 1, last = m->object_count - 1, end;
+    int8_t * chunk;
+    while (index < last) {
+        end = index | mask;
+        if (end > last) {
+            end = last;
+        }
+        chunk = m->chunks[index >> m->chunk_shift];
+        memmove(&chunk[(index & mask) * m->object_size], &chunk[((index & mask) + 1) * m->object_size], (end - index) * m->object_size);
+        if (end < last) {
+            memcpy(&chunk[(end & mask) * m->object_size], m->chunks[(end + 1) >> m->chunk_shift], m->object_size);
+        }
+        index = end + 1;
     }
 }
 
@@ -148,6 +225,13 @@ void	egMemArrayErase(egMemArray m, size_t index)
 {
     int8_t *item_p, *mov_p;
     size_t objects_to_move;
+    if (m->chunk_objects) {
+        if (index < m->object_count) {
+            egMemArrayEraseChunked(m, index);
+            --(m->object_count);
+        }
+        return;
+    }
     egMemArrayGetP(m, (void*)&item_p, index);
     egMemArrayGetP(m, (void*)&mov_p, index + 1);
     if (item_p != 0) {
@@ -167,15 +251,21 @@ void	egMemArrayErase(egMemArray m, size_t index)
 //on success, data points to the first element in an array of count uninitialized objects. on failure, it points to 0.
 void	egMemArrayAlloc(egMemArray m, void ** data, size_t count)
 {
-    size_t first_alloc = m->object_count * m->object_size;
-    egMemArrayResize(m, m->object_count + count);
-    *data = &(m->data)[first_alloc];
+    size_t first = m->object_count;
+    if (count == 0 || count > SIZE_MAX - first ||
+            (m->chunk_objects && (first >> m->chunk_shift) != ((first + count - 1) >> m->chunk_shift)) ||
+            !egMemArrayResize(m, first + count)) {
+        //chunked arrays can only hand out runs that fit in a single chunk
+        *data = 0;
+        return;
+    }
+    egMemArrayGetP(m, data, first);
 }
 
 //return 1 if this array will be automatically cleaned up
 int		egMemArrayManaged(egMemArray m)
 {
-    if (m->id == (size_t)-1) {
+    if (m->id == EG_HANDLE_NONE) {
         return 0;
     }
     return 1;
@@ -188,51 +278,274 @@ size_t	egMemArrayCount(egMemArray m)
 
 int8_t*	egMemArrayPointer(egMemArray m)
 {
+    if (m->chunk_objects) {
+        return m->chunk_count ? m->chunks[0] : 0;
+    }
     return m->data;
 }
 
+void	egMemArraySwapRemove(egMemArray m, size_t index)
+{
+    void * item, * back;
+    if (index >= m->object_count) {
+        return;
+    }
+    if (index != m->object_count - 1) {
+        egMemArrayGetP(m, &item, index);
+        egMemArrayGetP(m, &back, m->object_count - 1);
+        memcpy(item, back, m->object_size);
+    }
+    --(m->object_count);
+}
+
+//move count objects from index from down to index to, a contiguous run at a time
+static void egMemArrayMoveDown(egMemArray m, size_t to, size_t from, size_t count)
+{
+    size_t run_to, run_from, n;
+    int8_t * dest, * src;
+    while (count) {
+        dest = egMemArrayRun(m, to, &run_to);
+        src = egMemArrayRun(m, from, &run_from);
+        n = (run_to < run_from) ? run_to : run_from;
+        if (n > count) {
+            n = count;
+        }
+        memmove(dest, src, n * m->object_size);
+        to += n;
+        from += n;
+        count -= n;
+    }
+}
+
+void	egMemArrayEraseRange(egMemArray m, size_t index, size_t count)
+{
+    if (index >= m->object_count) {
+        return;
+    }
+    if (count > m->object_count - index) {
+        count = m->object_count - index;
+    }
+    egMemArrayMoveDown(m, index, index + count, m->object_count - (index + count));
+    m->object_count -= count;
+}
+
+size_t	egMemArrayRemoveIf(egMemArray m, int (*remove)(void * object, void * ctx), void * ctx)
+{
+    size_t i = 0, keep = 0, run, k;
+    int8_t * objects;
+    void * dest;
+
+    while (i < m->object_count) {
+        objects = egMemArrayRun(m, i, &run);
+        for (k = 0; k < run; ++k) {
+            if (remove(&objects[k * m->object_size], ctx)) {
+                continue;
+            }
+            if (keep != i + k) {
+                egMemArrayGetP(m, &dest, keep);
+                memcpy(dest, &objects[k * m->object_size], m->object_size);
+            }
+            ++keep;
+        }
+        i += run;
+    }
+    m->object_count = keep;
+    return i - keep;
+}
+
+egSpan	egMemArraySpan(egMemArray m, size_t index)
+{
+    size_t count;
+    int8_t * data = egMemArrayRun(m, index, &count);
+    return eg_span(data, count, m->object_size);
+}
 
-void	egMemArrayResize(egMemArray m, size_t object_count)
+int8_t*	egMemArrayRun(egMemArray m, size_t index, size_t * count)
 {
-    size_t nalloc = m->buffer_size;
-    //printf("resizing array of %u bytes to fit %u objects of size %u\n", nalloc, object_count, m->object_size);
-    while((nalloc / m->object_size) < object_count) {
-        nalloc *= 2;
-        if (nalloc > 100000) {
-            egMemArrayData * doop = 0;
-            doop->id -= 1;
+    void * redirect;
+    egMemArrayGetP(m, &redirect, index);
+    if (redirect == 0) {
+        *count = 0;
+    } else if (m->chunk_objects) {
+        *count = ((index | (m->chunk_objects - 1)) + 1) - index;
+        if (*count > m->object_count - index) {
+            *count = m->object_count - index;
         }
-        //printf("\tresize to %u...\n", nalloc);
+    } else {
+        *count = m->object_count - index;
+    }
+    return redirect;
+}
+
+
+//change the buffer to hold exactly capacity objects. never shrinks below object_count
+static int egMemArrayRealloc(egMemArray m, size_t capacity)
+{
+    int8_t * data;
+    if (capacity > SIZE_MAX / m->object_size) {
+        return 0;
+    }
+    data = (int8_t*)realloc(m->data, capacity * m->object_size);
+    if (data == 0 && capacity != 0) {
+        return 0;
+    }
+    m->data = data;
+    m->buffer_size = capacity * m->object_size;
+    ++(m->reallocs);
+    if (m->buffer_size > m->peak_bytes) {
+        m->peak_bytes = m->buffer_size;
     }
-    if (nalloc > m->buffer_size) {
-        m->data = (int8_t*)realloc(m->data, nalloc);
-        m->buffer_size = nalloc;
+    return 1;
+}
+
+void	egMemArraySetTag(egMemArray m, const char * tag)
+{
+    m->tag = tag;
+}
+
+void	egMemArraySetGrowth(egMemArray m, egMemGrowth growth, size_t step)
+{
+    m->growth = growth;
+    m->growth_step = step;
+}
+
+//add chunks until object_count objects fit. existing chunks never move
+static int egMemArrayAddChunks(egMemArray m, size_t object_count)
+{
+    size_t needed = (object_count >> m->chunk_shift) + ((object_count & (m->chunk_objects - 1)) ? 1 : 0);
+    size_t chunk_bytes = m->chunk_objects * m->object_size;
+    int8_t ** chunks;
+    if (needed <= m->chunk_count) {
+        return 1;
+    }
+    chunks = (int8_t**)realloc(m->chunks, needed * sizeof(int8_t*));
+    if (chunks == 0) {
+        return 0;
+    }
+    m->chunks = chunks;
+    ++(m->reallocs);
+    while (m->chunk_count < needed) {
+        chunks[m->chunk_count] = (int8_t*)malloc(chunk_bytes);
+        if (chunks[m->chunk_count] == 0) {
+            return 0;
+        }
+        ++(m->chunk_count);
+        ++(m->reallocs);
+        m->buffer_size += chunk_bytes;
+        if (m->buffer_size > m->peak_bytes) {
+            m->peak_bytes = m->buffer_size;
+        }
+    }
+    return 1;
+}
+
+int		egMemArrayReserve(egMemArray m, size_t object_count)
+{
+    if (object_count <= m->buffer_size / m->object_size) {
+        return 1;
+    }
+    if (m->chunk_objects) {
+        return egMemArrayAddChunks(m, object_count);
+    }
+    return egMemArrayRealloc(m, object_count);
+}
+
+//make room for object_count objects following m's growth policy, without changing the count
+static int egMemArrayGrow(egMemArray m, size_t object_count)
+{
+    size_t capacity = m->buffer_size / m->object_size, grown;
+    if (object_count > capacity) {
+        ++(m->resizes);
+    }
+    if (object_count > capacity && m->chunk_objects) {
+        //chunked arrays grow a chunk at a time whatever the policy says
+        if (!egMemArrayAddChunks(m, object_count)) {
+            return 0;
+        }
+    } else if (object_count > capacity) {
+        switch (m->growth) {
+        case EG_MEM_GROW_CHUNK:
+            //round up to a whole number of chunks
+            grown = m->growth_step ? m->growth_step : 1;
+            grown = ((object_count + grown - 1) / grown) * grown;
+            break;
+        case EG_MEM_GROW_EXACT:
+            grown = object_count;
+            break;
+        case EG_MEM_GROW_GEOMETRIC:
+        default:
+            grown = capacity + (capacity / 100) * m->growth_step + ((capacity % 100) * m->growth_step) / 100;
+            if (grown < capacity) {
+                //the geometric step overflowed, fall back to what was asked for
+                grown = object_count;
+            }
+            if (grown < 4) {
+                grown = 4;
+            }
+            break;
+        }
+        if (grown < object_count) {
+            grown = object_count;
+        }
+        //printf("resizing array of %u objects to fit %u objects of size %u\n", capacity, object_count, m->object_size);
+        if (!egMemArrayRealloc(m, grown) && !egMemArrayRealloc(m, object_count)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int		egMemArrayResize(egMemArray m, size_t object_count)
+{
+    if (!egMemArrayGrow(m, object_count)) {
+        return 0;
     }
     m->object_count = object_count;
+    return 1;
 }
 
 void	egMemArrayBack(egMemArray m, void ** data)
 {
-    *data = &(m->data)[((m->object_count - 1) * m->object_size)];
+    egMemArrayGetP(m, data, m->object_count - 1);
 }
 
 
 void	egMemPoolNew(egMemPool *p, size_t object_size, size_t object_count)
+{
+    egMemPoolNewEx(p, object_size, object_count, 0);
+}
+
+void	egMemPoolNewEx(egMemPool *p, size_t object_size, size_t object_count, uint32_t flags)
 {
     egMemPool a;
-    size_t id;
+    egHandle id;
     if (memPools == 0) {
-        a = malloc(sizeof(egMemArrayData));
-        id = -1;
+        a = malloc(sizeof(egMemPoolData));
+        id = EG_HANDLE_NONE;
     } else {
         egMemPoolAlloc(memPools, (void*)&a, &id);
     }
-    egMemArrayNew(&(a->data), object_size, object_count);
-    egMemArrayNew(&(a->usage), sizeof(uint8_t), object_count);
-    egMemArrayNew(&(a->recycle), sizeof(size_t), object_count);
+    if (flags & EG_MEMPOOL_CHUNKED) {
+        egMemArrayNewChunked(&(a->data), object_size, EG_MEM_CHUNK_SIZE);
+        egMemArrayReserve(a->data, object_count);
+    } else {
+        egMemArrayNew(&(a->data), object_size, object_count);
+    }
+    egMemArrayNew(&(a->usage), sizeof(uint64_t), (object_count + 63) >> 6);
+    egMemArrayNew(&(a->generation), sizeof(uint16_t), object_count);
+    egMemArrayNew(&(a->recycle), sizeof(egHandle), object_count);
+    a->sparse = 0;
+    a->dense = 0;
+    if (flags & EG_MEMPOOL_PACKED) {
+        egMemArrayNew(&(a->sparse), sizeof(uint32_t), object_count);
+        egMemArrayNew(&(a->dense), sizeof(egHandle), object_count);
+    }
 
     a->next_id = 0;
+    a->recycle_head = 0;
+    a->retired = 0;
     a->id = id;
+    a->flags = flags;
     *p = a;
 }
 
@@ -240,7 +553,12 @@ void	egMemPoolFree(egMemPool p)
 {
     egMemArrayFree(p->data);
     egMemArrayFree(p->usage);
+    egMemArrayFree(p->generation);
     egMemArrayFree(p->recycle);
+    if (p->sparse) {
+        egMemArrayFree(p->sparse);
+        egMemArrayFree(p->dense);
+    }
     if (egMemPoolManaged(p)) {
         egMemPoolErase(memPools, p->id);
     } else {
@@ -250,66 +568,284 @@ void	egMemPoolFree(egMemPool p)
 
 void	egMemPoolClear(egMemPool p)
 {
+    //retire every live handle so nothing from before the clear resolves afterwards
+    uint16_t * generation = (uint16_t*)p->generation->data;
+    size_t slot = egMemPoolScan(p, 0);
+    while (slot < p->next_id) {
+        ++generation[slot];
+        slot = egMemPoolScan(p, slot + 1);
+    }
+    //retired slots start over, or they'd take up room in the tables forever
+    for (slot = 0; slot < p->generation->object_count; ++slot) {
+        if (generation[slot] == EG_HANDLE_GENERATION_MAX) {
+            generation[slot] = 0;
+        }
+    }
     egMemArrayClear(p->data);
     egMemArrayClear(p->usage);
     egMemArrayClear(p->recycle);
+    if (p->sparse) {
+        egMemArrayClear(p->sparse);
+        egMemArrayClear(p->dense);
+    }
     p->next_id = 0;
+    p->recycle_head = 0;
+    p->retired = 0;
+}
+
+//erased slots waiting in the recycle queue
+static size_t egMemPoolRecycled(egMemPool p)
+{
+    return p->recycle->object_count - p->recycle_head;
+}
+
+//drop the used front of the recycle queue once it's at least as long as what's left
+static void egMemPoolRecycleCompact(egMemPool p)
+{
+    size_t left = egMemPoolRecycled(p);
+    if (p->recycle_head < left) {
+        return;
+    }
+    memmove(p->recycle->data, &(p->recycle->data)[p->recycle_head * sizeof(egHandle)], left * sizeof(egHandle));
+    p->recycle->object_count = left;
+    p->recycle_head = 0;
 }
 
-void	egMemPoolAlloc(egMemPool p, void ** data, size_t * id)
+void	egMemPoolAlloc(egMemPool p, void ** data, egHandle * id)
 {
     assert(id);
-    *id = p->next_id;
-    void * redirect;
-    uint8_t * usage_p = 0;
-    if (!egMemArrayPop(p->recycle, id)) {
-        ++(p->next_id);
+    egHandle slot = p->next_id;
+    void * redirect = 0;
+    int recycled = egMemPoolRecycled(p) > EG_MEMPOOL_MIN_FREE;
+    *data = 0;
+    *id = EG_HANDLE_NONE;
+    if (recycled) {
+        slot = ((egHandle*)p->recycle->data)[p->recycle_head];
+    } else if (slot >= EG_HANDLE_INDEX_MASK) {
+        //out of handle space
+        return;
     }
 
-    if (*id >= p->data->object_count) {
-        egMemArrayResize(p->data, *id + 1);
-        egMemArrayResize(p->usage, *id + 1);
-        p->data->object_count = *id + 1;
-        p->usage->object_count = *id + 1;
+    //grow every table before touching any of them, so a failed allocation leaves the pool as it was
+    if ((slot >> 6) >= p->usage->object_count) {
+        //new occupancy words start out empty
+        size_t old_words = p->usage->object_count;
+        if (!egMemArrayResize(p->usage, (slot >> 6) + 1)) {
+            return;
+        }
+        memset(&(p->usage->data)[old_words * sizeof(uint64_t)], 0, (p->usage->object_count - old_words) * sizeof(uint64_t));
     }
 
-    egMemArrayGetP(p->usage, (void*)&usage_p, *id);
-    //assert(usage_p);
+    if (slot >= p->generation->object_count) {
+        //slots that have never been used start at generation 0. slots survive clears with their generation intact.
+        size_t old_slots = p->generation->object_count;
+        if (!egMemArrayResize(p->generation, slot + 1)) {
+            return;
+        }
+        memset(&(p->generation->data)[old_slots * sizeof(uint16_t)], 0, (slot + 1 - old_slots) * sizeof(uint16_t));
+    }
 
-    *usage_p = (uint8_t)1;
+    if (p->flags & EG_MEMPOOL_PACKED) {
+        if ((slot >= p->sparse->object_count && !egMemArrayResize(p->sparse, slot + 1)) ||
+                !egMemArrayGrow(p->dense, p->dense->object_count + 1) ||
+                !egMemArrayGrow(p->data, p->data->object_count + 1)) {
+            return;
+        }
+    } else if (slot >= p->data->object_count && !egMemArrayResize(p->data, slot + 1)) {
+        return;
+    }
+
+    if (recycled) {
+        ++(p->recycle_head);
+        egMemPoolRecycleCompact(p);
+    } else {
+        ++(p->next_id);
+    }
+
+    ((uint64_t*)p->usage->data)[slot >> 6] |= (uint64_t)1 << (slot & 63);
+    *id = slot | ((egHandle)((uint16_t*)p->generation->data)[slot] << EG_HANDLE_INDEX_BITS);
+
+    if (p->flags & EG_MEMPOOL_PACKED) {
+        //new objects always go on the back of the dense array
+        uint32_t index = p->data->object_count;
+        ((uint32_t*)p->sparse->data)[slot] = index;
+        egMemArrayPush(p->dense, id);
+        egMemArrayAlloc(p->data, &redirect, 1);
+    } else {
+        egMemArrayGetP(p->data, &redirect, slot);
+    }
 
-    egMemArrayGetP(p->data, &redirect, *id);
     assert(redirect);
     *data = redirect;
 }
 
-void	egMemPoolGetP(egMemPool p, void ** data, size_t id)
+//set the occupancy bits of slots first to end - 1, a word at a time
+static void egMemPoolMarkRange(uint64_t * words, size_t first, size_t end)
+{
+    size_t bits;
+    while (first < end) {
+        bits = 64 - (first & 63);
+        if (bits > end - first) {
+            bits = end - first;
+        }
+        words[first >> 6] |= ((bits == 64) ? ~(uint64_t)0 : (((uint64_t)1 << bits) - 1)) << (first & 63);
+        first += bits;
+    }
+}
+
+size_t	egMemPoolAllocN(egMemPool p, size_t count, void ** data, egHandle * ids)
+{
+    size_t waiting = egMemPoolRecycled(p), spare = (waiting > EG_MEMPOOL_MIN_FREE) ? waiting - EG_MEMPOOL_MIN_FREE : 0;
+    size_t reused = (count < spare) ? count : spare;
+    size_t fresh = count - reused, first = p->next_id, end = first + fresh, base, i;
+    egHandle * recycle = (egHandle*)p->recycle->data + p->recycle_head, slot;
+    uint16_t * generation;
+    void * redirect;
+
+    if (count == 0 || fresh > EG_HANDLE_INDEX_MASK - first) {
+        return 0;
+    }
+
+    //grow every table once, up front. recycled slots are all below next_id, so end bounds them too
+    if (((end + 63) >> 6) > p->usage->object_count) {
+        size_t old_words = p->usage->object_count;
+        if (!egMemArrayResize(p->usage, (end + 63) >> 6)) {
+            return 0;
+        }
+        memset(&(p->usage->data)[old_words * sizeof(uint64_t)], 0, (p->usage->object_count - old_words) * sizeof(uint64_t));
+    }
+    if (end > p->generation->object_count) {
+        size_t old_slots = p->generation->object_count;
+        if (!egMemArrayResize(p->generation, end)) {
+            return 0;
+        }
+        memset(&(p->generation->data)[old_slots * sizeof(uint16_t)], 0, (end - old_slots) * sizeof(uint16_t));
+    }
+    if (p->flags & EG_MEMPOOL_PACKED) {
+        if ((end > p->sparse->object_count && !egMemArrayResize(p->sparse, end)) ||
+                !egMemArrayGrow(p->dense, p->dense->object_count + count) ||
+                !egMemArrayGrow(p->data, p->data->object_count + count)) {
+            return 0;
+        }
+    } else if (end > p->data->object_count && !egMemArrayResize(p->data, end)) {
+        return 0;
+    }
+
+    //recycled slots first, oldest first, to fill holes before growing, then one contiguous run of fresh ones
+    for (i = 0; i < reused; ++i) {
+        slot = recycle[i];
+        ((uint64_t*)p->usage->data)[slot >> 6] |= (uint64_t)1 << (slot & 63);
+        ids[i] = slot;
+    }
+    p->recycle_head += reused;
+    egMemPoolRecycleCompact(p);
+    egMemPoolMarkRange((uint64_t*)p->usage->data, first, end);
+    for (slot = first; slot < end; ++slot) {
+        ids[i++] = slot;
+    }
+    p->next_id = end;
+
+    generation = (uint16_t*)p->generation->data;
+    base = p->data->object_count;
+    if (p->flags & EG_MEMPOOL_PACKED) {
+        p->data->object_count += count;
+        p->dense->object_count += count;
+    }
+    for (i = 0; i < count; ++i) {
+        slot = ids[i];
+        ids[i] = slot | ((egHandle)generation[slot] << EG_HANDLE_INDEX_BITS);
+        if (p->flags & EG_MEMPOOL_PACKED) {
+            ((uint32_t*)p->sparse->data)[slot] = base + i;
+            ((egHandle*)p->dense->data)[base + i] = ids[i];
+            egMemArrayGetP(p->data, &redirect, base + i);
+        } else {
+            egMemArrayGetP(p->data, &redirect, slot);
+        }
+        if (data) {
+            data[i] = redirect;
+        }
+    }
+    return count;
+}
+
+size_t	egMemPoolEraseN(egMemPool p, const egHandle * ids, size_t count)
 {
-    uint8_t * usage_p;
+    size_t erased = 0, room = count;
+    //one growth of the recycle queue for the whole batch, halving the ask until it fits. erases past the
+    //reserved room grow the queue themselves, and only objects nothing can be found for stay alive
+    while (room && !egMemArrayGrow(p->recycle, p->recycle->object_count + room)) {
+        room >>= 1;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        erased += egMemPoolErase(p, ids[i]);
+    }
+    return erased;
+}
+
+int		egMemPoolValid(egMemPool p, egHandle id)
+{
+    return egMemPoolSlot(p, id) != (size_t)-1;
+}
+
+void	egMemPoolGetP(egMemPool p, void ** data, egHandle id)
+{
+    size_t slot = egMemPoolSlot(p, id);
     void * redirect = 0;
 
-    egMemArrayGetP(p->usage, (void*)&usage_p, id);
-    if (usage_p != 0 && *usage_p) {
-        //we're in the array, and the id is in use
-        egMemArrayGetP(p->data, &redirect, id);
+    if (slot != (size_t)-1) {
+        //we're in the array, and the id is current
+        if (p->flags & EG_MEMPOOL_PACKED) {
+            slot = ((uint32_t*)p->sparse->data)[slot];
+        }
+        egMemArrayGetP(p->data, &redirect, slot);
     }
 
     *data = redirect;
 }
 
-void	egMemPoolErase(egMemPool p, size_t id)
+int		egMemPoolErase(egMemPool p, egHandle id)
 {
-    uint8_t * usage_p;
-    egMemArrayGetP(p->usage, (void*)&usage_p, id);
-    if (usage_p != 0 && *usage_p) {
-        egMemArrayPush(p->recycle, &id);
-        *usage_p = 0;
+    size_t slot = egMemPoolSlot(p, id);
+    if (slot != (size_t)-1) {
+        //room for the slot in the recycle queue comes first, so running out of memory leaves the object alive
+        //instead of losing its slot. a slot about to retire never goes back in the queue
+        if (((uint16_t*)p->generation->data)[slot] + 1u != EG_HANDLE_GENERATION_MAX &&
+                !egMemArrayGrow(p->recycle, p->recycle->object_count + 1)) {
+            return 0;
+        }
+        if (p->flags & EG_MEMPOOL_PACKED) {
+            //fill the hole with the back object and point its id at the new home
+            uint32_t * sparse = (uint32_t*)p->sparse->data;
+            egHandle * dense = (egHandle*)p->dense->data;
+            uint32_t index = sparse[slot], last = p->data->object_count - 1;
+            if (index != last) {
+                void *hole, *back;
+                egMemArrayGetP(p->data, &hole, index);
+                egMemArrayGetP(p->data, &back, last);
+                memcpy(hole, back, p->data->object_size);
+                dense[index] = dense[last];
+                sparse[egHandleIndex(dense[index])] = index;
+            }
+            --(p->data->object_count);
+            --(p->dense->object_count);
+        }
+        //bumping the generation is what makes every outstanding copy of id stale
+        ((uint64_t*)p->usage->data)[slot >> 6] &= ~((uint64_t)1 << (slot & 63));
+        if (++((uint16_t*)p->generation->data)[slot] == EG_HANDLE_GENERATION_MAX) {
+            //every generation has been handed out. reusing the slot could revive a handle that's still held
+            ++(p->retired);
+            return 1;
+        }
+        egHandle s = slot;
+        egMemArrayPush(p->recycle, &s);
+        return 1;
     }
+    return 0;
 }
 
 int		egMemPoolManaged(egMemPool p)
 {
-    if (p->id == (size_t)-1) {
+    if (p->id == EG_HANDLE_NONE) {
         return 0;
     }
     return 1;
@@ -318,49 +854,493 @@ int		egMemPoolManaged(egMemPool p)
 size_t	egMemPoolCount(egMemPool p)
 {
     //the total will be the number of unique ids that have been allocated minus the number that are available for reuse
-    return p->next_id - egMemArrayCount(p->recycle);
+    return p->next_id - egMemPoolRecycled(p) - p->retired;
+}
+
+void	egMemPoolSetTag(egMemPool p, const char * tag)
+{
+    egMemArraySetTag(p->data, tag);
+    egMemArraySetTag(p->usage, tag);
+    egMemArraySetTag(p->generation, tag);
+    egMemArraySetTag(p->recycle, tag);
+    if (p->sparse) {
+        egMemArraySetTag(p->sparse, tag);
+        egMemArraySetTag(p->dense, tag);
+    }
+}
+
+int8_t*	egMemPoolPointer(egMemPool p)
+{
+    return egMemArrayPointer(p->data);
+}
+
+int8_t*	egMemPoolRun(egMemPool p, size_t index, size_t * count)
+{
+    return egMemArrayRun(p->data, index, count);
+}
+
+egHandle	egMemPoolIdAt(egMemPool p, size_t index)
+{
+    if (p->flags & EG_MEMPOOL_PACKED) {
+        return ((egHandle*)p->dense->data)[index];
+    }
+    return index | ((egHandle)((uint16_t*)p->generation->data)[index] << EG_HANDLE_INDEX_BITS);
 }
 
 size_t	egMemPoolFirst(egMemPool p)
 {
-    //return the first index in use
-    size_t index = 0;
-    uint8_t * usage_p;
-    egMemArrayGetP(p->usage, (void*)&usage_p, index);
-    //printf("looking for first index at %u\n", index);
-    while(usage_p != 0 && *usage_p == 0) {
-        ++index;
-        //printf("\t...%u...\n", index);
-        egMemArrayGetP(p->usage, (void*)&usage_p, index);
+    if (p->flags & EG_MEMPOOL_PACKED) {
+        return 0;
     }
-    //printf("Settled on %u\n", index);
-    return index;
+    //return the first index in use
+    return egMemPoolScan(p, 0);
 }
 
 //returns the data at id, or null when at the end. increments id to the next object.
 int8_t*	egMemPoolNext(egMemPool p, size_t * id)
 {
     assert(id);
-    //printf("start ID %u\n", *id);
 
-    if (*id >= p->next_id) {
+    void * redirect;
+    size_t slot;
+
+    if (p->flags & EG_MEMPOOL_PACKED) {
+        //no holes to skip, just walk the dense array
+        egMemArrayGetP(p->data, &redirect, *id);
+        if (redirect) {
+            ++(*id);
+        }
+        return redirect;
+    }
+
+    //the cursor is left just past the object returned, so one scan finds the next live slot even if
+    //objects were erased in between
+    slot = egMemPoolScan(p, *id);
+    if (slot >= p->next_id) {
+        *id = slot;
         return 0;
     }
+    *id = slot + 1;
 
-    void * redirect;
-    uint8_t * usage_p;
+    egMemArrayGetP(p->data, &redirect, slot);
+    return redirect;
+}
+
+
+//one row of egMemReport: every managed array sharing a tag
+typedef struct egMemReportRow {
+    const char * tag;
+    size_t arrays, used, reserved, peak, resizes, reallocs;
+} egMemReportRow;
+
+static int egMemReportCmp(const void * a, const void * b)
+{
+    const egMemReportRow * ra = a, * rb = b;
+    if (ra->reserved != rb->reserved) {
+        return (ra->reserved < rb->reserved) ? 1 : -1;
+    }
+    return strcmp(ra->tag, rb->tag);
+}
+
+static void egMemReportJSONString(FILE * out, const char * s)
+{
+    fputc('"', out);
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', out);
+        }
+        if ((unsigned char)*s >= 0x20) {
+            fputc(*s, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void egMemReportRowPrint(FILE * out, int format, const egMemReportRow * r)
+{
+    if (format == EG_MEM_REPORT_JSON) {
+        fprintf(out, "{\"tag\":");
+        egMemReportJSONString(out, r->tag);
+        fprintf(out, ",\"arrays\":%zu,\"used\":%zu,\"reserved\":%zu,\"peak\":%zu,\"resizes\":%zu,\"reallocs\":%zu}",
+                r->arrays, r->used, r->reserved, r->peak, r->resizes, r->reallocs);
+    } else {
+        fprintf(out, "%-24s %8zu %14zu %14zu %14zu %10zu %10zu\n",
+                r->tag, r->arrays, r->used, r->reserved, r->peak, r->resizes, r->reallocs);
+    }
+}
+
+void	egMemReport(FILE * out, int format)
+{
+    egMemReportRow * rows, total = {"total", 0, 0, 0, 0, 0, 0};
+    size_t row_count = 0, i, id;
+    egMemArray a;
 
-    egMemPoolGetP(p, &redirect, *id);
+    if (memArrays == 0) {
+        return;
+    }
+    rows = (egMemReportRow*)malloc((egMemPoolCount(memArrays) + 1) * sizeof(egMemReportRow));
+    if (rows == 0) {
+        return;
+    }
 
-    ++(*id);
-    egMemArrayGetP(p->usage, (void*)&usage_p, *id);
-    //printf("checking next id ID %u\n", *id);
+    //fold arrays into one row per tag
+    id = egMemPoolFirst(memArrays);
+    while ((a = (egMemArray)egMemPoolNext(memArrays, &id))) {
+        const char * tag = a->tag ? a->tag : "untagged";
+        for (i = 0; i < row_count && strcmp(rows[i].tag, tag); ++i) {
+        }
+        if (i == row_count) {
+            memset(&rows[i], 0, sizeof(egMemReportRow));
+            rows[i].tag = tag;
+            ++row_count;
+        }
+        ++(rows[i].arrays);
+        rows[i].used += a->object_count * a->object_size;
+        rows[i].reserved += a->buffer_size;
+        rows[i].peak += a->peak_bytes;
+        rows[i].resizes += a->resizes;
+        rows[i].reallocs += a->reallocs;
+    }
+    qsort(rows, row_count, sizeof(egMemReportRow), egMemReportCmp);
 
-    while(usage_p != 0 && *usage_p == 0 && *id < p->next_id) {
-        ++(*id);
-        //printf("checking next id ID %u\n", *id);
-        egMemArrayGetP(p->usage, (void*)&usage_p, *id);
+    if (format == EG_MEM_REPORT_JSON) {
+        fprintf(out, "{\"containers\":[");
+    } else {
+        fprintf(out, "%-24s %8s %14s %14s %14s %10s %10s\n", "tag", "arrays", "used", "reserved", "peak", "resizes", "reallocs");
+    }
+    for (i = 0; i < row_count; ++i) {
+        if (format == EG_MEM_REPORT_JSON && i) {
+            fputc(',', out);
+        }
+        egMemReportRowPrint(out, format, &rows[i]);
+        total.arrays += rows[i].arrays;
+        total.used += rows[i].used;
+        total.reserved += rows[i].reserved;
+        total.peak += rows[i].peak;
+        total.resizes += rows[i].resizes;
+        total.reallocs += rows[i].reallocs;
+    }
+    if (format == EG_MEM_REPORT_JSON) {
+        fprintf(out, "],\"total\":");
+        egMemReportRowPrint(out, format, &total);
+        fprintf(out, "}\n");
+    } else {
+        egMemReportRowPrint(out, format, &total);
+    }
+    free(rows);
+}
+
+//free list heads pack the slot + 1 (0 for empty) in the low half and the update tag in the high half
+#define EG_MEM_CPOOL_EMPTY 0
+
+int		egMemCPoolNew(egMemCPool * p, size_t object_size, size_t capacity)
+{
+    egMemCPool a;
+    *p = 0;
+    if (capacity > EG_HANDLE_INDEX_MASK || (capacity && object_size > SIZE_MAX / capacity)) {
+        return 0;
+    }
+    a = (egMemCPool)calloc(1, sizeof(egMemCPoolData));
+    if (a == 0) {
+        return 0;
     }
-    //printf("Settled on %u\n", *id);
+    a->data = (int8_t*)malloc(object_size * capacity);
+    a->next = calloc(capacity, sizeof(uint32_t));
+    a->state = calloc(capacity, sizeof(uint16_t));
+    a->usage = calloc((capacity + 63) >> 6, sizeof(uint64_t));
+    if (capacity && (a->data == 0 || a->next == 0 || a->state == 0 || a->usage == 0)) {
+        egMemCPoolFree(a);
+        return 0;
+    }
+    atomic_init(&(a->free_head), EG_MEM_CPOOL_EMPTY);
+    atomic_init(&(a->next_id), 0);
+    atomic_init(&(a->count), 0);
+    a->object_size = object_size;
+    a->capacity = capacity;
+    *p = a;
+    return 1;
+}
+
+void	egMemCPoolFree(egMemCPool p)
+{
+    free(p->data);
+    free((void*)p->next);
+    free((void*)p->state);
+    free((void*)p->usage);
+    free(p);
+}
+
+void	egMemCPoolAlloc(egMemCPool p, void ** data, egHandle * id)
+{
+    uint64_t head = atomic_load(&(p->free_head)), replace;
+    uint32_t slot;
+    uint16_t state;
+    *data = 0;
+    *id = EG_HANDLE_NONE;
+
+    //pop the free list
+    while ((uint32_t)head != EG_MEM_CPOOL_EMPTY) {
+        slot = (uint32_t)head - 1;
+        replace = ((head >> 32) + 1) << 32 | atomic_load_explicit(&(p->next[slot]), memory_order_relaxed);
+        if (atomic_compare_exchange_weak(&(p->free_head), &head, replace)) {
+            goto found;
+        }
+    }
+
+    //nothing recycled, take a fresh slot. the counter never passes capacity, so failed attempts don't eat ids
+    slot = atomic_load(&(p->next_id));
+    do {
+        if (slot >= p->capacity) {
+            return;
+        }
+    } while (!atomic_compare_exchange_weak(&(p->next_id), &slot, slot + 1));
+
+found:
+    //the slot is ours alone now, so plain stores are enough to bring it to life
+    state = atomic_load(&(p->state[slot])) | 1;
+    atomic_store(&(p->state[slot]), state);
+    atomic_fetch_or(&(p->usage[slot >> 6]), (uint64_t)1 << (slot & 63));
+    atomic_fetch_add(&(p->count), 1);
+    *id = slot | ((egHandle)(state >> 1) << EG_HANDLE_INDEX_BITS);
+    *data = &(p->data)[slot * p->object_size];
+}
+
+void	egMemCPoolGetP(egMemCPool p, void ** data, egHandle id)
+{
+    size_t slot = egHandleIndex(id);
+    *data = 0;
+    if (slot < atomic_load(&(p->next_id)) &&
+            atomic_load(&(p->state[slot])) == ((egHandleGeneration(id) << 1) | 1)) {
+        *data = &(p->data)[slot * p->object_size];
+    }
+}
+
+void	egMemCPoolErase(egMemCPool p, egHandle id)
+{
+    uint32_t slot = egHandleIndex(id);
+    uint16_t live = (egHandleGeneration(id) << 1) | 1;
+    uint64_t head, replace;
+    if (slot >= atomic_load(&(p->next_id))) {
+        return;
+    }
+    //whoever retires the live state owns the erase, so a stale or repeated erase can't recycle the slot twice
+    if (!atomic_compare_exchange_strong(&(p->state[slot]), &live, (uint16_t)((egHandleGeneration(id) + 1) << 1))) {
+        return;
+    }
+    atomic_fetch_and(&(p->usage[slot >> 6]), ~((uint64_t)1 << (slot & 63)));
+    atomic_fetch_sub(&(p->count), 1);
+    if (egHandleGeneration(id) + 1 == EG_HANDLE_GENERATION_MAX) {
+        //out of generations, the slot is retired rather than wrapped
+        return;
+    }
+
+    //push the slot on the free list
+    head = atomic_load(&(p->free_head));
+    do {
+        atomic_store_explicit(&(p->next[slot]), (uint32_t)head, memory_order_relaxed);
+        replace = ((head >> 32) + 1) << 32 | (slot + 1);
+    } while (!atomic_compare_exchange_weak(&(p->free_head), &head, replace));
+}
+
+size_t	egMemCPoolCount(egMemCPool p)
+{
+    return atomic_load(&(p->count));
+}
+
+//return the first slot at or after index that is in use, or next_id if there are none
+static size_t egMemCPoolScan(egMemCPool p, size_t index)
+{
+    size_t end = atomic_load(&(p->next_id));
+    size_t word = index >> 6, word_count = (end + 63) >> 6;
+    uint64_t bits;
+    if (word >= word_count) {
+        return end;
+    }
+    bits = atomic_load_explicit(&(p->usage[word]), memory_order_relaxed) & (~(uint64_t)0 << (index & 63));
+    while (bits == 0) {
+        if (++word >= word_count) {
+            return end;
+        }
+        bits = atomic_load_explicit(&(p->usage[word]), memory_order_relaxed);
+    }
+    index = (word << 6) + egMemCtz64(bits);
+    return (index < end) ? index : end;
+}
+
+size_t	egMemCPoolFirst(egMemCPool p)
+{
+    return egMemCPoolScan(p, 0);
+}
+
+int8_t*	egMemCPoolNext(egMemCPool p, size_t * id)
+{
+    assert(id);
+    *id = egMemCPoolScan(p, *id);
+    if (*id >= atomic_load(&(p->next_id))) {
+        return 0;
+    }
+    int8_t * redirect = &(p->data)[*id * p->object_size];
+    *id = egMemCPoolScan(p, *id + 1);
     return redirect;
 }
+
+//block headers are padded to this so the first allocation in a block is well aligned
+#define EG_MEM_ARENA_HEADER ((sizeof(egMemArenaBlock) + 15) & ~(size_t)15)
+
+static egMemArenaBlock * egMemArenaNewBlock(egMemArenaBlock * prev, size_t size)
+{
+    egMemArenaBlock * b = (egMemArenaBlock*)malloc(EG_MEM_ARENA_HEADER + size);
+    if (b) {
+        b->prev = prev;
+        b->size = size;
+        b->top = 0;
+    }
+    return b;
+}
+
+void	egMemArenaNew(egMemArena * a, size_t size)
+{
+    a->block_size = size;
+    a->block = egMemArenaNewBlock(0, size);
+}
+
+void	egMemArenaFree(egMemArena * a)
+{
+    egMemArenaBlock * prev;
+    while (a->block) {
+        prev = a->block->prev;
+        free(a->block);
+        a->block = prev;
+    }
+    a->block_size = 0;
+}
+
+void*	egMemArenaAlloc(egMemArena * a, size_t size, size_t align)
+{
+    egMemArenaBlock * b = a->block;
+    uintptr_t base, at;
+    size_t need;
+    assert(align && (align & (align - 1)) == 0);
+
+    if (b) {
+        base = (uintptr_t)b + EG_MEM_ARENA_HEADER;
+        at = (base + b->top + (align - 1)) & ~(uintptr_t)(align - 1);
+        if (at - base <= b->size && size <= b->size - (at - base)) {
+            b->top = (at - base) + size;
+            return (void*)at;
+        }
+    }
+
+    //out of room, chain on a block that fits this allocation and the usual block size
+    need = size + align;
+    if (need < size) {
+        return 0;
+    }
+    b = egMemArenaNewBlock(a->block, (need > a->block_size) ? need : a->block_size);
+    if (b == 0) {
+        return 0;
+    }
+    a->block = b;
+    base = (uintptr_t)b + EG_MEM_ARENA_HEADER;
+    at = (base + (align - 1)) & ~(uintptr_t)(align - 1);
+    b->top = (at - base) + size;
+    return (void*)at;
+}
+
+egMemArenaMarker	egMemArenaMark(egMemArena * a)
+{
+    egMemArenaMarker m;
+    m.block = a->block;
+    m.top = a->block ? a->block->top : 0;
+    return m;
+}
+
+void	egMemArenaRollback(egMemArena * a, egMemArenaMarker m)
+{
+    egMemArenaBlock * prev;
+    while (a->block && a->block != m.block) {
+        prev = a->block->prev;
+        free(a->block);
+        a->block = prev;
+    }
+    if (a->block) {
+        a->block->top = m.top;
+    }
+}
+
+void	egMemArenaReset(egMemArena * a)
+{
+    egMemArenaBlock * prev;
+    size_t total = 0;
+    if (a->block && a->block->prev == 0) {
+        //the common case: everything fit
+        a->block->top = 0;
+        return;
+    }
+    //fold the chain into one block that holds everything it held
+    while (a->block) {
+        total += a->block->size;
+        prev = a->block->prev;
+        free(a->block);
+        a->block = prev;
+    }
+    if (total > a->block_size) {
+        a->block_size = total;
+    }
+    a->block = egMemArenaNewBlock(0, a->block_size);
+}
+
+void	egMemArenaDoubleNew(egMemArenaDouble * d, size_t size)
+{
+    egMemArenaNew(&(d->arenas[0]), size);
+    egMemArenaNew(&(d->arenas[1]), size);
+    d->current = 0;
+}
+
+void	egMemArenaDoubleFree(egMemArenaDouble * d)
+{
+    egMemArenaFree(&(d->arenas[0]));
+    egMemArenaFree(&(d->arenas[1]));
+}
+
+void*	egMemArenaDoubleAlloc(egMemArenaDouble * d, size_t size, size_t align)
+{
+    return egMemArenaAlloc(&(d->arenas[d->current]), size, align);
+}
+
+void	egMemArenaDoubleFlip(egMemArenaDouble * d)
+{
+    d->current ^= 1;
+    egMemArenaReset(&(d->arenas[d->current]));
+}
+
+egMemArena*	egMemFrameArena(void)
+{
+    if (frameArena.block_size == 0) {
+        egMemArenaNew(&frameArena, EG_MEM_FRAME_ARENA_SIZE);
+    }
+    return &frameArena;
+}
+
+void*	egMemFrameAlloc(size_t size)
+{
+    return egMemArenaAlloc(egMemFrameArena(), size, 16);
+}
+
+void*	egMemFrameAllocDouble(size_t size)
+{
+    if (frameArenaDouble.arenas[0].block_size == 0) {
+        egMemArenaDoubleNew(&frameArenaDouble, EG_MEM_FRAME_ARENA_SIZE);
+    }
+    return egMemArenaDoubleAlloc(&frameArenaDouble, size, 16);
+}
+
+void	egMemFrameEnd(void)
+{
+    if (frameArena.block_size) {
+        egMemArenaReset(&frameArena);
+    }
+    if (frameArenaDouble.arenas[0].block_size) {
+        egMemArenaDoubleFlip(&frameArenaDouble);
+    }
+}
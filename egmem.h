@@ -22,27 +22,95 @@ THE SOFTWARE.
 #pragma once
 #include <stdint.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include "util/array.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+static inline size_t egMemCtz64(uint64_t x)
+{
+    unsigned long r;
+    _BitScanForward64(&r, x);
+    return r;
+}
+#else
+#define egMemCtz64(x) ((size_t)__builtin_ctzll(x))
+#endif
 
 void egMemInit(void);
 void egMemDeInit(void);
 
+enum egMemReportFormat {
+    EG_MEM_REPORT_TABLE = 0,
+    EG_MEM_REPORT_JSON
+};
+
+//write the memory held by every managed array to out, one row per tag, largest first.
+//bytes used by objects, bytes reserved now, peak bytes reserved, resizes that grew, and heap calls.
+void egMemReport(FILE * out, int format);
+
+//versioned object id. the low EG_HANDLE_INDEX_BITS pick a pool slot, the high bits count how many times that slot has been erased.
+//a slot whose count reaches EG_HANDLE_GENERATION_MAX is retired instead of wrapping, so a handle kept past its
+//object's erase never matches a later object in that slot and resolves to null. retired slots come back on
+//egMemPoolClear.
+typedef uint32_t egHandle;
+
+#define EG_HANDLE_INDEX_BITS		22
+#define EG_HANDLE_INDEX_MASK		((1u << EG_HANDLE_INDEX_BITS) - 1)
+#define EG_HANDLE_GENERATION_MAX	((1u << (32 - EG_HANDLE_INDEX_BITS)) - 1)
+#define EG_HANDLE_NONE				((egHandle)-1)
+
+#define egHandleIndex(h)		((h) & EG_HANDLE_INDEX_MASK)
+#define egHandleGeneration(h)	((h) >> EG_HANDLE_INDEX_BITS)
+
+//how an array picks its new capacity when it runs out of room
+typedef enum egMemGrowth {
+    //grow by growth_step percent of the current capacity. the default, with a step of 100
+    EG_MEM_GROW_GEOMETRIC = 0,
+    //grow to the next multiple of growth_step objects
+    EG_MEM_GROW_CHUNK,
+    //grow to exactly the requested size
+    EG_MEM_GROW_EXACT
+} egMemGrowth;
+
+//default chunk size for chunked arrays and pools
+#define EG_MEM_CHUNK_SIZE 65536
+
+//chunked arrays leave data null and keep objects in chunk_count separately allocated chunks of chunk_objects each
 typedef struct egMemArrayData {
     int8_t * data;
+    int8_t ** chunks;
     size_t object_size;
     size_t object_count;
     size_t buffer_size;
-    size_t id;
+    size_t growth_step;
+    size_t chunk_count, chunk_objects;
+    egMemGrowth growth;
+    uint32_t chunk_shift;
+    //accounting: a name for egMemReport, the largest buffer_size so far, calls to Resize that had to grow,
+    //and calls into the heap
+    const char * tag;
+    size_t peak_bytes, resizes, reallocs;
+    egHandle id;
 } egMemArrayData;
 
 typedef egMemArrayData * egMemArray;
 
 //new mem array for object_size sized objects, initially containing space for object_count of them
 void	egMemArrayNew(egMemArray *m, size_t object_size, size_t object_count);
+
+//new mem array that stores its objects in chunks of about chunk_size bytes. growing never moves existing objects,
+//so addresses from GetP stay good until the object is erased, but the array is only contiguous within a chunk
+void	egMemArrayNewChunked(egMemArray *m, size_t object_size, size_t chunk_size);
 void	egMemArrayFree(egMemArray m);
 void	egMemArrayClear(egMemArray m);
 
-//copy the value pointed to by data to the back of m, allocate space for it if needed
-void	egMemArrayPush(egMemArray m, const void * data);
+//copy the value pointed to by data to the back of m, allocate space for it if needed. return 0 if out of memory
+int		egMemArrayPush(egMemArray m, const void * data);
+
+//add one uninitialized object to the back of m and point data at it, to be built in place. on failure data points to 0
+void	egMemArrayEmplace(egMemArray m, void ** data);
 
 //pop the back of m as a stack, return 0 if empty, copies returned value to data on success. shrinks the array by one.
 int		egMemArrayPop(egMemArray m, void * data);
@@ -56,7 +124,18 @@ void	egMemArrayGetP(egMemArray m, void ** data, size_t index);
 //delete the contents of the array at index and shrink the array to remain contiguous
 void	egMemArrayErase(egMemArray m, size_t index);
 
+//delete the object at index by moving the back object into its place. O(1), but doesn't keep the order
+void	egMemArraySwapRemove(egMemArray m, size_t index);
+
+//delete count objects starting at index, moving the rest down once. keeps the order
+void	egMemArrayEraseRange(egMemArray m, size_t index, size_t count);
+
+//delete every object that remove returns nonzero for, in one pass that keeps the order of the rest.
+//return the number deleted
+size_t	egMemArrayRemoveIf(egMemArray m, int (*remove)(void * object, void * ctx), void * ctx);
+
 //on success, data points to the first element in an array of count uninitialized objects. on failure, it points to 0.
+//a chunked array fails if the run would cross into another chunk
 void	egMemArrayAlloc(egMemArray m, void ** data, size_t count);
 
 //return 1 if this array will be automatically cleaned up
@@ -64,38 +143,306 @@ int		egMemArrayManaged(egMemArray m);
 
 size_t	egMemArrayCount(egMemArray m);
 
+//the start of the buffer. for chunked arrays, only the first chunk
 int8_t*	egMemArrayPointer(egMemArray m);
 
-void	egMemArrayResize(egMemArray m, size_t object_count);
+//the address of the object at index and, in count, how many objects follow it contiguously (including itself)
+int8_t*	egMemArrayRun(egMemArray m, size_t index, size_t * count);
+
+//the same run as a span. for an unchunked array, egMemArraySpan(m, 0) views the whole array
+egSpan	egMemArraySpan(egMemArray m, size_t index);
+
+//set the number of objects in m, growing the buffer by its growth policy if needed.
+//return 0 and leave m untouched if the buffer can't be grown
+int		egMemArrayResize(egMemArray m, size_t object_count);
+
+//make room for object_count objects without changing the count. return 0 if out of memory
+int		egMemArrayReserve(egMemArray m, size_t object_count);
+
+void	egMemArraySetGrowth(egMemArray m, egMemGrowth growth, size_t step);
+
+//name m in egMemReport. tag is not copied, so it should be a string literal or otherwise outlive m
+void	egMemArraySetTag(egMemArray m, const char * tag);
 
 void	egMemArrayBack(egMemArray m, void ** data);
 
 
+//usage is a packed occupancy bitmap, one bit per slot in 64 bit words. generation holds a uint16_t per slot.
+//recycle is a queue of erased slots, taken from recycle_head, so the slot erased longest ago is reused first.
+//retired counts slots below next_id whose generation ran out.
+//packed pools also keep sparse (slot -> data index) and dense (data index -> id) tables
 typedef struct egMemPoolData {
-    egMemArray data, usage, recycle;
-    size_t next_id, id;
+    egMemArray data, usage, generation, recycle;
+    egMemArray sparse, dense;
+    size_t next_id, recycle_head, retired;
+    egHandle id;
+    uint32_t flags;
 } egMemPoolData;
 
 typedef egMemPoolData * egMemPool;
 
+//erased slots are only reused once more than this many are waiting, so one slot isn't erased and reused every frame
+#define EG_MEMPOOL_MIN_FREE 64
+
+enum egMemPoolFlags {
+    //keep live objects contiguous by moving the back object into erased slots. ids stay valid, addresses do not.
+    EG_MEMPOOL_PACKED = 1,
+    //store objects in a chunked array so growing the pool never moves them
+    EG_MEMPOOL_CHUNKED = 2
+};
+
 void	egMemPoolNew(egMemPool *p, size_t object_size, size_t object_count);
+void	egMemPoolNewEx(egMemPool *p, size_t object_size, size_t object_count, uint32_t flags);
 void	egMemPoolFree(egMemPool p);
+//erase every object. this is also the only place retired slots are reclaimed: their generations start over, so
+//handles to objects erased before the clear mustn't be kept past it.
+//a pool that is never cleared retires a slot after EG_HANDLE_GENERATION_MAX erases of it. each retired slot
+//keeps its place in the tables, and once about 2^EG_HANDLE_INDEX_BITS slots are used up (about four billion
+//erases in all) allocation fails. long running pools with constant churn should be cleared now and then
 void	egMemPoolClear(egMemPool p);
 
-void	egMemPoolAlloc(egMemPool p, void ** data, size_t * id);
+//pool ids are egHandles. erasing an object invalidates its id for good, even after the slot is reused.
+//on failure data points to 0 and id is EG_HANDLE_NONE
+void	egMemPoolAlloc(egMemPool p, void ** data, egHandle * id);
+
+int32_t	egMemPoolGet(egMemPool p, void * data, egHandle id);
+void	egMemPoolGetP(egMemPool p, void ** data, egHandle id);
 
-int32_t	egMemPoolGet(egMemPool p, void * data, size_t id);
-void	egMemPoolGetP(egMemPool p, void ** data, size_t id);
+//allocate count objects at once, growing each table at most once. ids (and data, unless it is null) receive
+//count entries. erased slots are reused first and the rest are a contiguous run of new ids.
+//return count, or 0 if nothing could be allocated
+size_t	egMemPoolAllocN(egMemPool p, size_t count, void ** data, egHandle * ids);
 
-void	egMemPoolErase(egMemPool p, size_t id);
+//return 1 if id refers to a live object
+int		egMemPoolValid(egMemPool p, egHandle id);
+
+//erase the object at id. return 1 if it was erased, or 0 if id is stale or there was no memory to recycle
+//its slot, in which case the object is left alive
+int		egMemPoolErase(egMemPool p, egHandle id);
+//erase count objects, return how many were erased
+size_t	egMemPoolEraseN(egMemPool p, const egHandle * ids, size_t count);
 
 int		egMemPoolManaged(egMemPool p);
 
+//tag every array p owns, see egMemArraySetTag
+void	egMemPoolSetTag(egMemPool p, const char * tag);
+
 size_t	egMemPoolCount(egMemPool p);
 
+//packed, unchunked pools only: the first of egMemPoolCount contiguous live objects
+int8_t*	egMemPoolPointer(egMemPool p);
+
+//packed pools only: the object at data index and, in count, how many live objects follow it contiguously
+int8_t*	egMemPoolRun(egMemPool p, size_t index, size_t * count);
+
+//the id of the object at data index (packed pools) or slot index (others)
+egHandle	egMemPoolIdAt(egMemPool p, size_t index);
+
 size_t	egMemPoolFirst(egMemPool p);
 
 //returns the data at id, or null when at the end. increments id to the next object.
+//id is a cursor, not an object id: a slot index, or a position in the data array for packed pools.
 int8_t*	egMemPoolNext(egMemPool p, size_t * id);
 
+//return the slot of id if it refers to a live object, or -1 if it is stale or was never allocated
+static inline size_t egMemPoolSlot(egMemPool p, egHandle id)
+{
+    size_t slot = egHandleIndex(id);
+    if (slot >= p->next_id ||
+            !((((uint64_t*)p->usage->data)[slot >> 6] >> (slot & 63)) & 1) ||
+            ((uint16_t*)p->generation->data)[slot] != egHandleGeneration(id)) {
+        return (size_t)-1;
+    }
+    return slot;
+}
+
+//return the first slot at or after index that is in use, or next_id if there are none.
+//walks the occupancy bitmap a word at a time so runs of dead slots cost one compare per 64 ids
+static inline size_t egMemPoolScan(egMemPool p, size_t index)
+{
+    uint64_t * words = (uint64_t*)p->usage->data;
+    size_t word = index >> 6;
+    size_t word_count = (p->next_id + 63) >> 6;
+    uint64_t bits;
+
+    if (word >= word_count) {
+        return p->next_id;
+    }
+    //live slot under the cursor. in dense runs this branch is predicted and the next slot doesn't wait on a ctz
+    if (index < p->next_id && ((words[word] >> (index & 63)) & 1)) {
+        return index;
+    }
+    bits = words[word] & (~(uint64_t)0 << (index & 63));
+    while (bits == 0) {
+        if (++word >= word_count) {
+            return p->next_id;
+        }
+        bits = words[word];
+    }
+    index = (word << 6) + egMemCtz64(bits);
+    return (index < p->next_id) ? index : p->next_id;
+}
+
+//typed front end. EG_MEM_ARRAY_TYPED(name, type) defines inline functions for an egMemArray of type:
+//name##New, name##At (no bounds check), name##Get (null past the end), name##Push and name##Count.
+//the object size is a compile time constant, so loops over them inline and vectorise like loops over a plain array.
+//the array must have been made with sizeof(type) objects. everything else goes through the egMemArray calls
+#define EG_MEM_ARRAY_TYPED(name, type) \
+static inline void name##New(egMemArray * m, size_t object_count) \
+{ \
+    egMemArrayNew(m, sizeof(type), object_count); \
+} \
+static inline type * name##At(egMemArray m, size_t index) \
+{ \
+    if (m->chunk_objects) { \
+        return (type*)m->chunks[index >> m->chunk_shift] + (index & (m->chunk_objects - 1)); \
+    } \
+    return (type*)m->data + index; \
+} \
+static inline type * name##Get(egMemArray m, size_t index) \
+{ \
+    return (index < m->object_count) ? name##At(m, index) : (type*)0; \
+} \
+static inline int name##Push(egMemArray m, const type * value) \
+{ \
+    if ((m->object_count + 1) * sizeof(type) <= m->buffer_size) { \
+        *name##At(m, m->object_count++) = *value; \
+        return 1; \
+    } \
+    return egMemArrayPush(m, value); \
+} \
+static inline size_t name##Count(egMemArray m) \
+{ \
+    return m->object_count; \
+}
+
+//EG_MEM_POOL_TYPED(name, type) does the same for an egMemPool of type: name##New, name##Alloc, name##Get and
+//name##Next, which takes a cursor from egMemPoolFirst like egMemPoolNext. the pool's data array gets name##Data functions
+#define EG_MEM_POOL_TYPED(name, type) \
+EG_MEM_ARRAY_TYPED(name##Data, type) \
+static inline void name##New(egMemPool * p, size_t object_count, uint32_t flags) \
+{ \
+    egMemPoolNewEx(p, sizeof(type), object_count, flags); \
+} \
+static inline type * name##Alloc(egMemPool p, egHandle * id) \
+{ \
+    void * data; \
+    egMemPoolAlloc(p, &data, id); \
+    return (type*)data; \
+} \
+static inline type * name##Get(egMemPool p, egHandle id) \
+{ \
+    size_t slot = egMemPoolSlot(p, id); \
+    if (slot == (size_t)-1) { \
+        return 0; \
+    } \
+    if (p->flags & EG_MEMPOOL_PACKED) { \
+        slot = ((uint32_t*)p->sparse->data)[slot]; \
+    } \
+    return name##DataAt(p->data, slot); \
+} \
+static inline type * name##Next(egMemPool p, size_t * cursor) \
+{ \
+    if (p->flags & EG_MEMPOOL_PACKED) { \
+        return (*cursor < p->data->object_count) ? name##DataAt(p->data, (*cursor)++) : (type*)0; \
+    } \
+    *cursor = egMemPoolScan(p, *cursor); \
+    if (*cursor >= p->next_id) { \
+        return 0; \
+    } \
+    return name##DataAt(p->data, (*cursor)++); \
+}
+
+
+
+//fixed capacity pool that any number of threads can allocate from and erase into at once, without a lock.
+//never used slots are handed out by an atomic bump counter, and erased slots go on a free list whose head
+//carries a tag that changes on every update so a stale compare-and-swap can't succeed (the ABA problem).
+//each slot's generation and live bit share one atomic word, so an erase validates and retires a handle in one step.
+//objects never move. iterating with First/Next is only safe while no other thread is allocating or erasing.
+typedef struct egMemCPoolData {
+    int8_t * data;
+    _Atomic uint32_t * next;
+    _Atomic uint16_t * state;
+    _Atomic uint64_t * usage;
+    _Atomic uint64_t free_head;
+    _Atomic uint32_t next_id;
+    _Atomic uint32_t count;
+    size_t object_size, capacity;
+} egMemCPoolData;
+
+typedef egMemCPoolData * egMemCPool;
+
+//return 0 if the pool couldn't be allocated. capacity can be at most EG_HANDLE_INDEX_MASK objects
+int		egMemCPoolNew(egMemCPool * p, size_t object_size, size_t capacity);
+void	egMemCPoolFree(egMemCPool p);
+
+//on failure, including when the pool is full, data points to 0 and id is EG_HANDLE_NONE.
+//there's no clear, so a slot retired after EG_HANDLE_GENERATION_MAX erases stays out of use until the pool is freed
+void	egMemCPoolAlloc(egMemCPool p, void ** data, egHandle * id);
+void	egMemCPoolGetP(egMemCPool p, void ** data, egHandle id);
+void	egMemCPoolErase(egMemCPool p, egHandle id);
+
+size_t	egMemCPoolCount(egMemCPool p);
+
+size_t	egMemCPoolFirst(egMemCPool p);
+int8_t*	egMemCPoolNext(egMemCPool p, size_t * id);
+
+//linear allocator. allocations are bumped off the current block and only ever released all at once,
+//by rolling back to a marker or resetting. when a block runs out another is chained on, and the next
+//reset folds the chain into a single block big enough for the lot, so a steady workload stops touching the heap.
+typedef struct egMemArenaBlock {
+    struct egMemArenaBlock * prev;
+    size_t size, top;
+} egMemArenaBlock;
+
+typedef struct egMemArena {
+    egMemArenaBlock * block;
+    size_t block_size;
+} egMemArena;
+
+typedef struct egMemArenaMarker {
+    egMemArenaBlock * block;
+    size_t top;
+} egMemArenaMarker;
+
+//two arenas used on alternate frames, so an allocation lives until the end of the frame after the one it was made in
+typedef struct egMemArenaDouble {
+    egMemArena arenas[2];
+    int current;
+} egMemArenaDouble;
+
+void	egMemArenaNew(egMemArena * a, size_t size);
+void	egMemArenaFree(egMemArena * a);
+
+//return size uninitialized bytes aligned to align, a power of two. return 0 if out of memory
+void*	egMemArenaAlloc(egMemArena * a, size_t size, size_t align);
+
+egMemArenaMarker	egMemArenaMark(egMemArena * a);
+
+//release everything allocated since marker m was taken
+void	egMemArenaRollback(egMemArena * a, egMemArenaMarker m);
+
+//release everything
+void	egMemArenaReset(egMemArena * a);
+
+void	egMemArenaDoubleNew(egMemArenaDouble * d, size_t size);
+void	egMemArenaDoubleFree(egMemArenaDouble * d);
+void*	egMemArenaDoubleAlloc(egMemArenaDouble * d, size_t size, size_t align);
+
+//switch to the other arena and reset it, releasing what was allocated two flips ago
+void	egMemArenaDoubleFlip(egMemArenaDouble * d);
+
+#define EG_MEM_FRAME_ARENA_SIZE 262144
+
+//engine scratch arena, reset by egMemFrameEnd. take a marker and roll back for scratch that dies sooner
+egMemArena*	egMemFrameArena(void);
+
+//frame scratch that lives until the end of this frame
+void*	egMemFrameAlloc(size_t size);
+
+//frame scratch that lives until the end of the next frame
+void*	egMemFrameAllocDouble(size_t size);
 
+//release this frame's scratch. called by egCoreTick once the frame is done
+void	egMemFrameEnd(void);
@@ -23,6 +23,7 @@ THE SOFTWARE.
 #include <math.h>
 #include <string.h>
 #include "util/array.h"
+#include "egmem.h"
 egRenderer renderer = {0};
 
 
@@ -142,31 +143,38 @@ void egRendererLookAt( egV3 eye, egV3 lookat, egV3 up)
 
 egMap textureMap = {{0}};
 
-int egRstrcmp(const void * a, const void * b) {
-	return strcmp( (char*)a, (char*)b);
+unsigned int egRendererGetTexid( const char * name )
+{
+    return egRendererGetTexidAtom(egAtomIntern(name));
 }
 
-unsigned int egRendererGetTexid( const char * name )
+unsigned int egRendererGetTexidAtom( egAtom atom )
 {
     unsigned int texid, * texidp;
     size_t suffixstart;
     char * fname;
+    const char * name;
 
     if (textureMap.kcomp == 0) {
-        textureMap = eg_map_new(2, sizeof(char) * 16, sizeof(unsigned int), egRstrcmp);
+        textureMap = eg_map_new_hash(2, sizeof(egAtom), sizeof(unsigned int), egAtomCmp, egAtomHash);
     }
 
-    texidp = eg_map_get(&textureMap, name, 0);
+    texidp = eg_map_get(&textureMap, &atom, 0);
 
     if (texidp == 0) {
+        egMemArenaMarker mark = egMemArenaMark(egMemFrameArena());
+        name = egAtomName(atom);
+        if (name == 0) {
+            return 0;
+        }
         suffixstart = strlen(name);
-        fname = malloc(suffixstart + 5);
+        fname = egMemArenaAlloc(egMemFrameArena(), suffixstart + 5, 1);
         strcpy(fname, name);
         strcat(fname, ".png");
         //printf("filename %s from %s\n", fname, name);
         texid = renderer.LoadTexture(fname);
-        free(fname);
-        eg_map_insert(&textureMap, name, &texid);
+        egMemArenaRollback(egMemFrameArena(), mark);
+        eg_map_insert(&textureMap, &atom, &texid);
         return texid;
     }
     return *texidp;
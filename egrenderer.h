@@ -25,6 +25,7 @@ THE SOFTWARE.
 #include <SDL2/SDL.h>
 #include "util/egmath.h"
 #include "model.h"
+#include "egatom.h"
 
 enum eg_renderer_e {
     EG_GL3 = 0,
@@ -73,6 +74,8 @@ void egRendererOrtho(float l, float r, float b, float t, float n, float f);
 void egRendererOrthoRatio(float w, float h, float scale, float n, float f);
 
 unsigned int egRendererGetTexid( const char * name );
+//textures are loaded from the atom's name plus ".png" the first time they are asked for
+unsigned int egRendererGetTexidAtom( egAtom name );
 void egRendererSetTexture( const char * name );
 void egRendererSetTexid( unsigned int texid );
 
@@ -21,6 +21,7 @@ THE SOFTWARE.
 */
 #include "iqm.h"
 #include "model.h"
+#include "egmem.h"
 #include <physfs.h>
 #include <stddef.h>
 #include <string.h>
@@ -40,12 +41,13 @@ int eg_iqmvalidate(iqmheader * head)
 int eg_iqmload(const char * const iqmfilename)
 {
     PHYSFS_File * fiqm = PHYSFS_openRead(iqmfilename);
+    egMemArenaMarker mark = egMemArenaMark(egMemFrameArena());
     egModelPattern modelpattern = {0};
     egVertex * vertices = 0;
     //FILE * fiqm = fopen(iqmfilename, "rb");
     int ecode = 1;//, isle = islittleendian();
     //printf("%s, %d\n",isle?"environment is little endian":"environment is big endian",isle);
-    void * buffer = malloc(PHYSFS_fileLength(fiqm));
+    void * buffer = egMemArenaAlloc(egMemFrameArena(), PHYSFS_fileLength(fiqm), 16);
     //printf("header size: %u\n", sizeof(iqmheader));
     //printf("file length: %ul\n", PHYSFS_fileLength(fiqm));
 
@@ -66,7 +68,7 @@ int eg_iqmload(const char * const iqmfilename)
     modelpattern.joints = (egJoint*)(buffer + head->ofs_joints);
 
     //load interleaved vertices from vertex arrays
-    vertices = malloc(sizeof(egVertex) * head->num_vertexes);
+    vertices = egMemArenaAlloc(egMemFrameArena(), sizeof(egVertex) * head->num_vertexes, 16);
     iqmvertexarray * varray = (iqmvertexarray*)(buffer + head->ofs_vertexarrays);
     for (int j = 0; j < head->num_vertexarrays; ++j) {
         void * vcopyto;
@@ -147,17 +149,12 @@ int eg_iqmload(const char * const iqmfilename)
     }
 
 
-    static char mname[16] = {0};
-    strncpy(mname, iqmfilename, 15);
-
-    for (int i = (int)(strchr(iqmfilename, '.') - iqmfilename); i < 16; ++i) {
-        mname[i] = '\0';
-    }
-    egModelNew(modelpattern, mname);
+    //the model is named after the file, up to the extension
+    const char * extension = strchr(iqmfilename, '.');
+    egModelNewAtom(modelpattern, egAtomInternN(iqmfilename, extension ? (size_t)(extension - iqmfilename) : strlen(iqmfilename)));
 error:
     //free(joints);
-    free(buffer);
-    free(vertices);
+    egMemArenaRollback(egMemFrameArena(), mark);
     eg_freeModelPattern(modelpattern);
     PHYSFS_close(fiqm);
     return ecode;
@@ -22,6 +22,7 @@ THE SOFTWARE.
 #include "model.h"
 #include "util/array.h"
 #include "util/egmath.h"
+#include <string.h>
 
 egVec eg_vertices;
 egVec eg_triangles;
@@ -29,17 +30,13 @@ egVec eg_joints;
 egVec eg_meshes;
 egMap eg_models;
 
-int egModstrcmp( const void *a, const void *b ){
-	return strcmp( (char*)a, (char*)b);
-}
-
 void eg_initmodels()
 {
     eg_vertices = eg_vec_new(0,sizeof(egVertex));
     eg_triangles = eg_vec_new(0,sizeof(egTriangle));
     eg_joints = eg_vec_new(0,sizeof(egJoint));
-    eg_meshes = eg_vec_new(0,sizeof(egJoint));
-    eg_models = eg_map_new(0,(sizeof(char)*16), sizeof(egModel),egModstrcmp);
+    eg_meshes = eg_vec_new(0,sizeof(egMesh));
+    eg_models = eg_map_new_hash(0,sizeof(egAtom), sizeof(egModel),egAtomCmp,egAtomHash);
 }
 
 void eg_shutdownmodels()
@@ -74,26 +71,43 @@ void eg_freeModelPattern(egModelPattern p)
 
 egMesh * eg_meshes_new(egMeshPattern p)
 {
-    egMesh m;
-    m.ofs_vert = eg_vertices.element_count;
-    m.ofs_tri = eg_triangles.element_count;
-
-    m.verts = p.vert_count;
-    m.tris = p.triangle_count;
-    for (int i = 0; i < p.vert_count; ++i) {
-        eg_vec_push(&eg_vertices, (p.vertices) + i);
-        //printf("\n\tVertex %u\n", i);
-        //egV3Print((p.vertices + i)->position);
+    egMesh * m;
+    egVertex * verts;
+    egTriangle * tris;
+
+    //make room for the whole mesh first, so a failure leaves nothing half added
+    verts = eg_vec_emplace_n(&eg_vertices, p.vert_count);
+    if (verts == 0) {
+        return 0;
+    }
+    tris = eg_vec_emplace_n(&eg_triangles, p.triangle_count);
+    if (tris == 0) {
+        eg_vertices.element_count -= p.vert_count;
+        return 0;
     }
-    for (int i = 0; i < p.triangle_count; ++i) {
-        eg_vec_push(&eg_triangles, (p.triangles) + i);
-        //printf("\tTriangle %u\n\t%u\t%u\t%u\n", i, (p.triangles + i)->indices[0], (p.triangles + i)->indices[1], (p.triangles + i)->indices[2]);
+    m = eg_vec_emplace(&eg_meshes);
+    if (m == 0) {
+        eg_vertices.element_count -= p.vert_count;
+        eg_triangles.element_count -= p.triangle_count;
+        return 0;
     }
-    //eg_map_at(&eg_meshes, eg_map_insert(&eg_meshes, name, &m),0,&result);
-    return eg_vec_at(&eg_meshes, eg_vec_push(&eg_meshes, &m));
+
+    m->ofs_vert = eg_vertices.element_count - p.vert_count;
+    m->ofs_tri = eg_triangles.element_count - p.triangle_count;
+    m->verts = p.vert_count;
+    m->tris = p.triangle_count;
+    m->vao = 0;
+    memcpy(verts, p.vertices, p.vert_count * sizeof(egVertex));
+    memcpy(tris, p.triangles, p.triangle_count * sizeof(egTriangle));
+    return m;
 }
 
 void egModelNew(egModelPattern p, char name[16])
+{
+    egModelNewAtom(p, egAtomIntern(name));
+}
+
+void egModelNewAtom(egModelPattern p, egAtom name)
 {
     egModel m;
 
@@ -115,10 +129,15 @@ void egModelNew(egModelPattern p, char name[16])
         //printf("\nMesh %u\n", i);
         eg_meshes_new(*(p.meshes + i));
     }
-    eg_map_insert(&eg_models, &name[0], &m);
+    eg_map_insert(&eg_models, &name, &m);
 }
 
 egModel * egModelGet(char name[16])
 {
-    return eg_map_get(&eg_models, &name[0], 0);
+    return egModelGetAtom(egAtomFind(name));
+}
+
+egModel * egModelGetAtom(egAtom name)
+{
+    return eg_map_get(&eg_models, &name, 0);
 }
@@ -24,6 +24,7 @@ THE SOFTWARE.
 #include "iqm.h"
 //#include "util/array.h"
 #include "util/egmath.h"
+#include "egatom.h"
 #include "GL/glew.h"
 
 typedef struct egModel egModel;
@@ -92,6 +93,8 @@ void        eg_freeModelPattern(egModelPattern p);
 
 egMesh *    eg_meshes_new(egMeshPattern p);
 void        egModelNew(egModelPattern p, char name[16]);
+void        egModelNewAtom(egModelPattern p, egAtom name);
 egModel *   egModelGet(char name[16]);
+egModel *   egModelGetAtom(egAtom name);
 
 
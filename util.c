@@ -22,6 +22,7 @@ THE SOFTWARE.
 #include "util/array.h"
 #include "util/sort.h"
 #include "util/endian.h"
+#include "egmem.h"
 #include <string.h>
 #include <stdint.h>
 #include <assert.h>
@@ -47,6 +48,228 @@ int eg_insertion_sort(void *data[], size_t n, int (*comp)(void*, void*))
     return 0;
 }
 
+//hidden helpers for the generic sorts
+
+static void eg_sort_swap(char * a, char * b, size_t size)
+{
+    char temp[64];
+    size_t part;
+    while (size) {
+        part = (size < sizeof(temp)) ? size : sizeof(temp);
+        memcpy(temp, a, part);
+        memcpy(a, b, part);
+        memcpy(b, temp, part);
+        a += part;
+        b += part;
+        size -= part;
+    }
+}
+
+//stable, since an element only moves past strictly greater ones
+static void eg_sort_insertion(char * data, size_t n, size_t size, egSortComp comp, void * ctx)
+{
+    size_t i, j;
+    for (i = 1; i < n; ++i) {
+        for (j = i; j > 0 && comp(data + j * size, data + (j - 1) * size, ctx) < 0; --j) {
+            eg_sort_swap(data + j * size, data + (j - 1) * size, size);
+        }
+    }
+}
+
+static void eg_sort_sift(char * data, size_t root, size_t n, size_t size, egSortComp comp, void * ctx)
+{
+    size_t child;
+    while ((child = 2 * root + 1) < n) {
+        if (child + 1 < n && comp(data + child * size, data + (child + 1) * size, ctx) < 0) {
+            ++child;
+        }
+        if (comp(data + root * size, data + child * size, ctx) >= 0) {
+            return;
+        }
+        eg_sort_swap(data + root * size, data + child * size, size);
+        root = child;
+    }
+}
+
+static void eg_sort_heap(char * data, size_t n, size_t size, egSortComp comp, void * ctx)
+{
+    size_t i;
+    for (i = n / 2; i-- > 0;) {
+        eg_sort_sift(data, i, n, size, comp, ctx);
+    }
+    for (i = n; i-- > 1;) {
+        eg_sort_swap(data, data + i * size, size);
+        eg_sort_sift(data, 0, i, size, comp, ctx);
+    }
+}
+
+static void eg_sort_intro(char * data, size_t n, size_t size, egSortComp comp, void * ctx, int depth)
+{
+    size_t i, j, mid;
+    char * last;
+
+    while (n > 16) {
+        if (depth-- == 0) {
+            eg_sort_heap(data, n, size, comp, ctx);
+            return;
+        }
+        //order the first, middle and last elements, then use the middle one as the pivot from the front.
+        //the last element is now no less than the pivot, which stops the left scan
+        mid = n / 2;
+        last = data + (n - 1) * size;
+        if (comp(data + mid * size, data, ctx) < 0) {
+            eg_sort_swap(data + mid * size, data, size);
+        }
+        if (comp(last, data, ctx) < 0) {
+            eg_sort_swap(last, data, size);
+        }
+        if (comp(last, data + mid * size, ctx) < 0) {
+            eg_sort_swap(last, data + mid * size, size);
+        }
+        eg_sort_swap(data, data + mid * size, size);
+
+        //hoare partition. both scans stop on elements equal to the pivot, so runs of equal keys split evenly
+        i = 0;
+        j = n;
+        for (;;) {
+            do {
+                ++i;
+            } while (comp(data + i * size, data, ctx) < 0);
+            do {
+                --j;
+            } while (comp(data, data + j * size, ctx) < 0);
+            if (i >= j) {
+                break;
+            }
+            eg_sort_swap(data + i * size, data + j * size, size);
+        }
+        eg_sort_swap(data, data + j * size, size);
+
+        //recurse into the smaller side and loop on the larger, so the stack stays O(log n)
+        if (j < n - j - 1) {
+            eg_sort_intro(data, j, size, comp, ctx, depth);
+            data += (j + 1) * size;
+            n -= j + 1;
+        } else {
+            eg_sort_intro(data + (j + 1) * size, n - j - 1, size, comp, ctx, depth);
+            n = j;
+        }
+    }
+    eg_sort_insertion(data, n, size, comp, ctx);
+}
+
+void eg_sort(void * data, size_t n, size_t size, egSortComp comp, void * ctx)
+{
+    int depth = 0;
+    size_t i;
+    for (i = n; i > 1; i >>= 1) {
+        depth += 2;
+    }
+    eg_sort_intro(data, n, size, comp, ctx, depth);
+}
+
+int eg_sort_stable(void * data, size_t n, size_t size, void * scratch, egSortComp comp, void * ctx)
+{
+    char * from = data, * to, * swap;
+    void * owned = 0;
+    size_t width, lo, mid, hi, a, b, k;
+
+    if (n < 2) {
+        return 1;
+    }
+    if (scratch == 0) {
+        scratch = owned = malloc(n * size);
+        if (scratch == 0) {
+            return 0;
+        }
+    }
+    to = scratch;
+
+    //insertion sort short runs in place, then merge runs of doubling width back and forth between the buffers
+    for (lo = 0; lo < n; lo += 16) {
+        eg_sort_insertion(from + lo * size, (n - lo < 16) ? n - lo : 16, size, comp, ctx);
+    }
+    for (width = 16; width < n; width *= 2) {
+        for (lo = 0; lo < n; lo += 2 * width) {
+            mid = (lo + width < n) ? lo + width : n;
+            hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+            a = lo;
+            b = mid;
+            k = lo;
+            //take from the left run on ties to keep equal elements in order
+            while (a < mid && b < hi) {
+                if (comp(from + b * size, from + a * size, ctx) < 0) {
+                    memcpy(to + (k++) * size, from + (b++) * size, size);
+                } else {
+                    memcpy(to + (k++) * size, from + (a++) * size, size);
+                }
+            }
+            memcpy(to + k * size, from + a * size, (mid - a) * size);
+            k += mid - a;
+            memcpy(to + k * size, from + b * size, (hi - b) * size);
+        }
+        swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != (char*)data) {
+        memcpy(data, from, n * size);
+    }
+    free(owned);
+    return 1;
+}
+
+//lsd radix sort over the low key_bytes bytes of each key. the digits of every pass are counted in one read of
+//the data, and elements are copied whole, so the payload comes along
+#define EG_RADIX_SORT(name, type, key_bytes) \
+int name(type * data, size_t n, type * scratch) \
+{ \
+    size_t counts[key_bytes][256] = {{0}}; \
+    size_t i, pass, digit, offset, sum; \
+    type * from = data, * to, * swap; \
+    void * owned = 0; \
+    if (n < 2) { \
+        return 1; \
+    } \
+    if (scratch == 0) { \
+        scratch = owned = malloc(n * sizeof(type)); \
+        if (scratch == 0) { \
+            return 0; \
+        } \
+    } \
+    to = scratch; \
+    for (i = 0; i < n; ++i) { \
+        for (pass = 0; pass < key_bytes; ++pass) { \
+            ++counts[pass][(data[i].key >> (pass * 8)) & 0xff]; \
+        } \
+    } \
+    for (pass = 0; pass < key_bytes; ++pass) { \
+        offset = (data[0].key >> (pass * 8)) & 0xff; \
+        if (counts[pass][offset] == n) { \
+            continue; \
+        } \
+        for (digit = 0, sum = 0; digit < 256; ++digit) { \
+            offset = counts[pass][digit]; \
+            counts[pass][digit] = sum; \
+            sum += offset; \
+        } \
+        for (i = 0; i < n; ++i) { \
+            to[counts[pass][(from[i].key >> (pass * 8)) & 0xff]++] = from[i]; \
+        } \
+        swap = from; \
+        from = to; \
+        to = swap; \
+    } \
+    if (from != data) { \
+        memcpy(data, from, n * sizeof(type)); \
+    } \
+    free(owned); \
+    return 1; \
+}
+
+EG_RADIX_SORT(eg_radix_sort32, egSortKey32, 4)
+EG_RADIX_SORT(eg_radix_sort64, egSortKey64, 8)
+
 // -------       array functions
 
 
@@ -69,10 +292,32 @@ egVec eg_vec_new(size_t alloc_size, size_t element_size)
     v.alloc_size = alloc_size;
     v.element_size = element_size;
     v.element_count = 0;
+    v.storage = EG_VEC_HEAP;
+    v.arena = 0;
 
     return v;
 }
 
+egVec eg_vec_new_buffer(void * buffer, size_t alloc_size, size_t element_size)
+{
+    egVec v = {0};
+    v.elements = buffer;
+    v.element_size = element_size;
+    v.alloc_size = alloc_size;
+    v.storage = EG_VEC_BUFFER;
+    return v;
+}
+
+egVec eg_vec_new_arena(struct egMemArena * arena, size_t alloc_size, size_t element_size)
+{
+    egVec v = {0};
+    v.element_size = element_size;
+    v.storage = EG_VEC_ARENA;
+    v.arena = arena;
+    eg_vec_resize(&v, alloc_size);
+    return v;
+}
+
 //vector accessor
 void * eg_vec_at(egVec* v, size_t element)
 {
@@ -95,6 +340,11 @@ int eg_vec_pop(egVec* v, void * element)
     return 1;
 }
 
+egSpan eg_vec_span(egVec* v)
+{
+    return eg_span(v->elements, v->element_count, v->element_size);
+}
+
 //vector insertion
 int eg_vec_push(egVec* v, void * element)
 {
@@ -106,6 +356,28 @@ int eg_vec_push(egVec* v, void * element)
     return v->element_count - 1;
 }
 
+void * eg_vec_emplace(egVec* v)
+{
+    return eg_vec_emplace_n(v, 1);
+}
+
+void * eg_vec_emplace_n(egVec* v, size_t count)
+{
+    size_t first = v->element_count;
+    size_t grown = (v->alloc_size) ? v->alloc_size * 2 : 2;
+    if (first + count > v->alloc_size) {
+        //grow like insert, but always far enough for the whole batch
+        if (grown < first + count) {
+            grown = first + count;
+        }
+        if (!eg_vec_resize(v, grown) && !eg_vec_resize(v, first + count)) {
+            return NULL;
+        }
+    }
+    v->element_count += count;
+    return (char*)v->elements + first * v->element_size;
+}
+
 int eg_vec_insert(egVec* v, void * element, size_t position)
 {
     if (!eg_vec_insert_helper(v)) {
@@ -146,9 +418,35 @@ int eg_vec_shrinkwrap(egVec* v)
 }
 int eg_vec_resize(egVec* v, size_t new_allocsize)
 {
+    void * elements;
     if (new_allocsize < v->element_count) {
         v->element_count = new_allocsize;
     }
+    if (v->storage != EG_VEC_HEAP) {
+        //we can't realloc memory we don't own. shrinking stays put, growing copies to a new buffer
+        if (new_allocsize <= v->alloc_size) {
+            v->alloc_size = new_allocsize;
+            return 1;
+        }
+        if (v->storage == EG_VEC_ARENA) {
+            elements = egMemArenaAlloc(v->arena, new_allocsize * v->element_size, 16);
+        } else {
+            elements = malloc(new_allocsize * v->element_size);
+        }
+        if (elements == 0) {
+            return 0;
+        }
+        if (v->element_count) {
+            memcpy(elements, v->elements, v->element_count * v->element_size);
+        }
+        if (v->storage == EG_VEC_BUFFER) {
+            //outgrew the caller's buffer, from here on we own a heap one
+            v->storage = EG_VEC_HEAP;
+        }
+        v->elements = elements;
+        v->alloc_size = new_allocsize;
+        return 1;
+    }
     //printf("resizing to %u elements; %u bytes\n",new_allocsize, new_allocsize * v->element_size);
     v->alloc_size = new_allocsize;
     v->elements = realloc(v->elements, v->alloc_size * v->element_size);
@@ -172,6 +470,50 @@ int eg_vec_erase(egVec* v, size_t position)
     return position - 1;
 }
 
+int eg_vec_swap_remove(egVec* v, size_t position)
+{
+    char * d = v->elements;
+    if (position >= v->element_count) {
+        return 0;
+    }
+    --v->element_count;
+    if (position != v->element_count) {
+        memcpy(&d[position * v->element_size], &d[v->element_count * v->element_size], v->element_size);
+    }
+    return 1;
+}
+
+int eg_vec_erase_range(egVec* v, size_t position, size_t count)
+{
+    char * d = v->elements;
+    if (position >= v->element_count) {
+        return 0;
+    }
+    if (count > v->element_count - position) {
+        count = v->element_count - position;
+    }
+    memmove(&d[position * v->element_size], &d[(position + count) * v->element_size], (v->element_count - position - count) * v->element_size);
+    v->element_count -= count;
+    return 1;
+}
+
+size_t eg_vec_remove_if(egVec* v, int (*remove)(void * element, void * ctx), void * ctx)
+{
+    char * d = v->elements;
+    size_t i, keep = 0;
+    for (i = 0; i < v->element_count; ++i) {
+        if (remove(&d[i * v->element_size], ctx)) {
+            continue;
+        }
+        if (keep != i) {
+            memcpy(&d[keep * v->element_size], &d[i * v->element_size], v->element_size);
+        }
+        ++keep;
+    }
+    v->element_count = keep;
+    return i - keep;
+}
+
 int eg_vec_clear(egVec* v)
 {
     v->element_count = 0;
@@ -187,17 +529,138 @@ int eg_vec_free(egVec* v)
 
 // --------- map functions
 
+//hashed map index entry. index is the entry's position in keys plus one, so a zeroed slot is empty
+typedef struct egMapSlot {
+    uint32_t hash;
+    uint32_t index;
+} egMapSlot;
+
+//hidden helpers for hashed maps
+
+//put an entry in the index, robin hood style: walking the probe sequence, the entry takes the place of any
+//that is closer to its home slot, and that one carries on instead. keeps probe lengths short and even
+static void eg_map_slot_place(egMap * m, uint32_t hash, uint32_t index)
+{
+    size_t mask = m->slot_count - 1, pos = hash & mask, dist = 0, sdist;
+    egMapSlot cur = {hash, index}, swap;
+
+    while (m->slots[pos].index) {
+        sdist = (pos - (m->slots[pos].hash & mask)) & mask;
+        if (sdist < dist) {
+            swap = m->slots[pos];
+            m->slots[pos] = cur;
+            cur = swap;
+            dist = sdist;
+        }
+        pos = (pos + 1) & mask;
+        ++dist;
+    }
+    m->slots[pos] = cur;
+}
+
+static int eg_map_rehash(egMap * m, size_t slot_count)
+{
+    egMapSlot * slots = calloc(slot_count, sizeof(egMapSlot));
+    uint32_t * hashes = m->hashes.elements;
+    if (slots == 0) {
+        return 0;
+    }
+    free(m->slots);
+    m->slots = slots;
+    m->slot_count = slot_count;
+    for (size_t i = 0; i < m->keys.element_count; ++i) {
+        eg_map_slot_place(m, hashes[i], i + 1);
+    }
+    return 1;
+}
+
+//return the slot pointing at the entry whose key is key, or slot_count if there isn't one.
+//with key null, look for the slot pointing at entry index instead
+static size_t eg_map_slot_find(egMap * m, const void * key, uint32_t hash, size_t index)
+{
+    size_t mask = m->slot_count - 1, pos = hash & mask, dist = 0;
+    egMapSlot * s;
+
+    if (m->slot_count == 0) {
+        return 0;
+    }
+    for (;;) {
+        s = &m->slots[pos];
+        //an empty slot, or one that would have been displaced by us, means the key isn't here
+        if (s->index == 0 || ((pos - (s->hash & mask)) & mask) < dist) {
+            return m->slot_count;
+        }
+        if (s->hash == hash) {
+            if (key) {
+                if (m->kcomp(key, (char*)m->keys.elements + (s->index - 1) * m->keys.element_size) == 0) {
+                    return pos;
+                }
+            } else if (s->index == index + 1) {
+                return pos;
+            }
+        }
+        pos = (pos + 1) & mask;
+        ++dist;
+    }
+}
+
+//empty slot pos, shifting the rest of its cluster back so lookups don't need tombstones
+static void eg_map_slot_remove(egMap * m, size_t pos)
+{
+    size_t mask = m->slot_count - 1, next = (pos + 1) & mask;
+    while (m->slots[next].index && ((next - (m->slots[next].hash & mask)) & mask) != 0) {
+        m->slots[pos] = m->slots[next];
+        pos = next;
+        next = (next + 1) & mask;
+    }
+    m->slots[pos].index = 0;
+}
+
+uint32_t eg_hash_name16(const void * key)
+{
+    const unsigned char * c = key;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < 16 && c[i]; ++i) {
+        hash ^= c[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 
 //map constructor
 egMap eg_map_new(size_t alloc_size, size_t key_size, size_t value_size, int (*kcomp)(const void * a, const void * b))
 {
-    egMap m;
+    egMap m = {0};
     m.kcomp = kcomp;
     m.keys = eg_vec_new(alloc_size, key_size);
     m.values = eg_vec_new(alloc_size, value_size);
     return m;
 }
 
+egMap eg_map_new_arena(struct egMemArena * arena, size_t alloc_size, size_t key_size, size_t value_size, int (*kcomp)(const void * a, const void * b))
+{
+    egMap m = {0};
+    m.kcomp = kcomp;
+    m.keys = eg_vec_new_arena(arena, alloc_size, key_size);
+    m.values = eg_vec_new_arena(arena, alloc_size, value_size);
+    return m;
+}
+
+egMap eg_map_new_hash(size_t alloc_size, size_t key_size, size_t value_size, int (*kcomp)(const void * a, const void * b), uint32_t (*khash)(const void * key))
+{
+    egMap m = eg_map_new(alloc_size, key_size, value_size, kcomp);
+    size_t slot_count = 16;
+    m.khash = khash;
+    m.hashes = eg_vec_new(alloc_size, sizeof(uint32_t));
+    //room for alloc_size entries without a rehash
+    while (slot_count * 7 < alloc_size * 8) {
+        slot_count *= 2;
+    }
+    eg_map_rehash(&m, slot_count);
+    return m;
+}
+
 //map accessors
 int eg_map_at(egMap * m, size_t element, const void ** key, void ** value)
 {
@@ -219,6 +682,19 @@ void * eg_map_get(egMap * m, const void * key, size_t * el)
 {
     size_t left = 0, right = m->keys.element_count, center;
     void * data;
+
+    if (m->khash) {
+        center = eg_map_slot_find(m, key, m->khash(key), 0);
+        if (center < m->slot_count) {
+            center = m->slots[center].index - 1;
+            if (el)
+                *el = center;
+            return eg_vec_at(&(m->values), center);
+        }
+        if (el)
+            *el = -1;
+        return 0;
+    }
     while (left < right) {
         center = (left + right) / 2;
         //printf("%u - %u - %u\n",left, center, right);
@@ -246,6 +722,31 @@ void * eg_map_get(egMap * m, const void * key, size_t * el)
 void * eg_map_insert(egMap * m, const void * key, void * value)
 {
     size_t index;
+    uint32_t hash;
+
+    if (m->khash) {
+        hash = m->khash(key);
+        index = eg_map_slot_find(m, key, hash, 0);
+        if (index < m->slot_count) {
+            index = m->slots[index].index - 1;
+            memcpy(eg_vec_at(&(m->values), index), value, m->values.element_size);
+            return eg_vec_at(&(m->values), index);
+        }
+        //keep the table at most 7/8 full
+        if ((m->keys.element_count + 1) * 8 > m->slot_count * 7 && !eg_map_rehash(m, m->slot_count ? m->slot_count * 2 : 16)) {
+            return 0;
+        }
+        index = m->keys.element_count;
+        if (!eg_vec_insert_helper(&(m->keys)) || !eg_vec_insert_helper(&(m->values)) || !eg_vec_insert_helper(&(m->hashes))) {
+            return 0;
+        }
+        eg_vec_push(&(m->keys), (void*)key);
+        eg_vec_push(&(m->values), value);
+        eg_vec_push(&(m->hashes), &hash);
+        eg_map_slot_place(m, hash, index + 1);
+        return eg_vec_at(&(m->values), index);
+    }
+
     //printf("%s inserted\n", (char*)key);
     //get to a point where we're no longer greater than that index
     for (index = 0; index < m->keys.element_count && m->kcomp(key, eg_vec_at(&(m->keys),index)) > 0; ++index) {
@@ -256,6 +757,100 @@ void * eg_map_insert(egMap * m, const void * key, void * value)
     return eg_vec_at(&(m->values), index);
 }
 
+//hidden helper: compare two indices into a batch of keys by the keys they pick out
+typedef struct egMapBatch {
+    egMap * m;
+    const char * keys;
+} egMapBatch;
+
+static int eg_map_batch_comp(const void * a, const void * b, void * ctx)
+{
+    egMapBatch * batch = ctx;
+    size_t ks = batch->m->keys.element_size;
+    return batch->m->kcomp(batch->keys + *(const size_t*)a * ks, batch->keys + *(const size_t*)b * ks);
+}
+
+int eg_map_build(egMap * m, const void * keys, const void * values, size_t count)
+{
+    size_t ks = m->keys.element_size, vs = m->values.element_size;
+    size_t n = m->keys.element_count, i, * order;
+    egMapBatch batch = {m, keys};
+    const char * bkeys = keys, * bvalues = values;
+    char * mkeys, * mvalues;
+    long a, b, k;
+
+    if (count == 0) {
+        return 1;
+    }
+    if (!eg_map_reserve(m, n + count)) {
+        return 0;
+    }
+    if (m->khash) {
+        //no order to keep, so just insert
+        for (i = 0; i < count; ++i) {
+            if (!eg_map_insert(m, bkeys + i * ks, (void*)(bvalues + i * vs))) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+
+    order = malloc(2 * count * sizeof(size_t));
+    if (order == 0) {
+        return 0;
+    }
+    for (i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    //stable, so equal keys keep their batch order
+    eg_sort_stable(order, count, sizeof(size_t), order + count, eg_map_batch_comp, &batch);
+
+    //merge from the back, so every entry moves once and nothing is overwritten before it's read.
+    //existing keys go before equal new ones
+    mkeys = m->keys.elements;
+    mvalues = m->values.elements;
+    a = (long)n - 1;
+    b = (long)count - 1;
+    for (k = (long)(n + count) - 1; b >= 0; --k) {
+        if (a >= 0 && m->kcomp(mkeys + a * ks, bkeys + order[b] * ks) > 0) {
+            memcpy(mkeys + k * ks, mkeys + a * ks, ks);
+            memcpy(mvalues + k * vs, mvalues + a * vs, vs);
+            --a;
+        } else {
+            memcpy(mkeys + k * ks, bkeys + order[b] * ks, ks);
+            memcpy(mvalues + k * vs, bvalues + order[b] * vs, vs);
+            --b;
+        }
+    }
+    m->keys.element_count = n + count;
+    m->values.element_count = n + count;
+    free(order);
+    return 1;
+}
+
+int eg_map_reserve(egMap * m, size_t element_count)
+{
+    size_t slot_count = m->slot_count ? m->slot_count : 16;
+    if (m->keys.alloc_size < element_count && !eg_vec_resize(&(m->keys), element_count)) {
+        return 0;
+    }
+    if (m->values.alloc_size < element_count && !eg_vec_resize(&(m->values), element_count)) {
+        return 0;
+    }
+    if (m->khash) {
+        if (m->hashes.alloc_size < element_count && !eg_vec_resize(&(m->hashes), element_count)) {
+            return 0;
+        }
+        while (slot_count * 7 < element_count * 8) {
+            slot_count *= 2;
+        }
+        if (slot_count != m->slot_count && !eg_map_rehash(m, slot_count)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 //map maintainance
 int eg_map_erase(egMap * m, const void * key)
 {
@@ -268,8 +863,24 @@ int eg_map_erase(egMap * m, const void * key)
 
 int eg_map_erase_at(egMap * m, size_t element)
 {
+    size_t last = m->keys.element_count - 1;
+    uint32_t * hashes = m->hashes.elements;
     if (element >= m->keys.element_count)
         return 0;
+    if (m->khash) {
+        //drop the entry from the index, then move the last entry into its place and repoint that one's slot
+        eg_map_slot_remove(m, eg_map_slot_find(m, 0, hashes[element], element));
+        if (element != last) {
+            m->slots[eg_map_slot_find(m, 0, hashes[last], last)].index = element + 1;
+            memcpy(eg_vec_at(&(m->keys), element), eg_vec_at(&(m->keys), last), m->keys.element_size);
+            memcpy(eg_vec_at(&(m->values), element), eg_vec_at(&(m->values), last), m->values.element_size);
+            hashes[element] = hashes[last];
+        }
+        --m->keys.element_count;
+        --m->values.element_count;
+        --m->hashes.element_count;
+        return 1;
+    }
     eg_vec_erase(&(m->keys), element);
     eg_vec_erase(&(m->values), element);
     return 1;
@@ -279,11 +890,181 @@ void eg_map_clear(egMap * m)
 {
     eg_vec_clear(&(m->keys));
     eg_vec_clear(&(m->values));
+    eg_vec_clear(&(m->hashes));
+    if (m->slots) {
+        memset(m->slots, 0, m->slot_count * sizeof(egMapSlot));
+    }
 }
 void eg_map_free(egMap * m)
 {
     eg_vec_free(&(m->keys));
     eg_vec_free(&(m->values));
+    if (m->khash) {
+        eg_vec_free(&(m->hashes));
+    }
+    free(m->slots);
+    m->slots = 0;
+    m->slot_count = 0;
 }
 
+// --------- structure of arrays functions
 
+//hidden helper: an aligned buffer for count elements of a column, padded out to a whole number of
+//EG_SOA_ALIGN bytes. block gets the pointer to free
+static void * eg_soa_alloc_column(size_t size, size_t count, void ** block)
+{
+    size_t bytes = (size * count + EG_SOA_ALIGN - 1) & ~(size_t)(EG_SOA_ALIGN - 1);
+    char * raw = malloc(bytes + EG_SOA_ALIGN);
+    *block = raw;
+    if (raw == 0) {
+        return 0;
+    }
+    return (void*)(((uintptr_t)raw + EG_SOA_ALIGN - 1) & ~(uintptr_t)(EG_SOA_ALIGN - 1));
+}
+
+egSoA eg_soa_new(size_t alloc_size)
+{
+    egSoA s;
+    memset(&s, 0, sizeof(s));
+    s.alloc_size = alloc_size;
+    return s;
+}
+
+int eg_soa_add_column(egSoA * s, const char * name, size_t size)
+{
+    size_t c = s->column_count;
+    if (c == EG_SOA_MAX_COLUMNS) {
+        return -1;
+    }
+    s->columns[c] = eg_soa_alloc_column(size, s->alloc_size, &(s->blocks[c]));
+    if (s->columns[c] == 0) {
+        return -1;
+    }
+    memset(s->columns[c], 0, size * s->element_count);
+    s->sizes[c] = size;
+    s->names[c] = name;
+    ++s->column_count;
+    return c;
+}
+
+int eg_soa_column(egSoA * s, const char * name)
+{
+    for (size_t c = 0; c < s->column_count; ++c) {
+        if (strcmp(s->names[c], name) == 0) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+void * eg_soa_at(egSoA * s, size_t column, size_t element)
+{
+    if (column >= s->column_count || element >= s->element_count) {
+        return NULL;
+    }
+    return (char*)s->columns[column] + element * s->sizes[column];
+}
+
+void * eg_soa_data(egSoA * s, size_t column)
+{
+    return (column < s->column_count) ? s->columns[column] : NULL;
+}
+
+int eg_soa_push(egSoA * s, const void * const * values)
+{
+    char * at;
+    if (s->element_count == s->alloc_size) {
+        //same policy as egVec, double or fail
+        if (!eg_soa_resize(s, (s->alloc_size) ? s->alloc_size * 2 : 2)) {
+            return 0;
+        }
+    }
+    for (size_t c = 0; c < s->column_count; ++c) {
+        at = (char*)s->columns[c] + s->element_count * s->sizes[c];
+        if (values && values[c]) {
+            memcpy(at, values[c], s->sizes[c]);
+        } else {
+            memset(at, 0, s->sizes[c]);
+        }
+    }
+    ++s->element_count;
+    return 1;
+}
+
+int eg_soa_resize(egSoA * s, size_t new_allocsize)
+{
+    void * columns[EG_SOA_MAX_COLUMNS], * blocks[EG_SOA_MAX_COLUMNS];
+    size_t c, keep = (new_allocsize < s->element_count) ? new_allocsize : s->element_count;
+
+    //allocate every column before touching any, so a failure leaves s as it was
+    for (c = 0; c < s->column_count; ++c) {
+        columns[c] = eg_soa_alloc_column(s->sizes[c], new_allocsize, &blocks[c]);
+        if (columns[c] == 0) {
+            while (c-- > 0) {
+                free(blocks[c]);
+            }
+            return 0;
+        }
+    }
+    for (c = 0; c < s->column_count; ++c) {
+        memcpy(columns[c], s->columns[c], keep * s->sizes[c]);
+        free(s->blocks[c]);
+        s->columns[c] = columns[c];
+        s->blocks[c] = blocks[c];
+    }
+    s->element_count = keep;
+    s->alloc_size = new_allocsize;
+    return 1;
+}
+
+int eg_soa_erase(egSoA * s, size_t element)
+{
+    char * at;
+    if (element >= s->element_count) {
+        return 0;
+    }
+    for (size_t c = 0; c < s->column_count; ++c) {
+        at = (char*)s->columns[c] + element * s->sizes[c];
+        memmove(at, at + s->sizes[c], (s->element_count - element - 1) * s->sizes[c]);
+    }
+    --s->element_count;
+    return 1;
+}
+
+int eg_soa_swap_remove(egSoA * s, size_t element)
+{
+    size_t last = s->element_count - 1;
+    if (element >= s->element_count) {
+        return 0;
+    }
+    if (element != last) {
+        for (size_t c = 0; c < s->column_count; ++c) {
+            memcpy((char*)s->columns[c] + element * s->sizes[c], (char*)s->columns[c] + last * s->sizes[c], s->sizes[c]);
+        }
+    }
+    --s->element_count;
+    return 1;
+}
+
+void eg_soa_swap(egSoA * s, size_t a, size_t b)
+{
+    if (a >= s->element_count || b >= s->element_count || a == b) {
+        return;
+    }
+    for (size_t c = 0; c < s->column_count; ++c) {
+        eg_sort_swap((char*)s->columns[c] + a * s->sizes[c], (char*)s->columns[c] + b * s->sizes[c], s->sizes[c]);
+    }
+}
+
+void eg_soa_clear(egSoA * s)
+{
+    s->element_count = 0;
+}
+
+void eg_soa_free(egSoA * s)
+{
+    for (size_t c = 0; c < s->column_count; ++c) {
+        free(s->blocks[c]);
+    }
+    memset(s, 0, sizeof(*s));
+}
@@ -22,6 +22,40 @@ THE SOFTWARE.
 #pragma once
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+
+struct egMemArena;
+
+//where a vector's elements live. heap vectors own a malloc'd buffer. buffer vectors start in memory the caller
+//owns, like a local array or space inside another struct, and move to the heap if they outgrow it.
+//arena vectors take every buffer from an egMemArena and never free one; the arena releases them all at once
+enum egVecStorage {
+    EG_VEC_HEAP = 0,
+    EG_VEC_BUFFER,
+    EG_VEC_ARENA
+};
+
+//view of count elements, stride bytes apart, starting at data. doesn't own anything, so it's cheap to pass by value
+typedef struct egSpan {
+    void * data;
+    size_t count;
+    size_t stride;
+} egSpan;
+
+static inline egSpan eg_span(void * data, size_t count, size_t stride)
+{
+    egSpan s = {data, count, stride};
+    return s;
+}
+
+static inline void * eg_span_at(egSpan s, size_t element)
+{
+    return (char*)s.data + element * s.stride;
+}
+
+//view of one member of every struct in a span of type, e.g. the positions of a span of colliders
+#define eg_span_member(s, type, member) eg_span((char*)(s).data + offsetof(type, member), (s).count, (s).stride)
 
 //vector handle
 typedef struct egVec egVec;
@@ -31,40 +65,103 @@ struct egVec {
     size_t element_size;
     size_t element_count;
     size_t alloc_size;
+    int storage;
+    struct egMemArena * arena;
 };
 
+//maps keep keys sorted for binary search, unless made with eg_map_new_hash. hashed maps keep entries in
+//insertion order (erasing moves the last entry into the hole), each key's hash in hashes, and an open
+//addressing robin hood table of slot_count slots pointing into them. kcomp is then only tested for equality
 struct egMap {
     egVec keys;
     egVec values;
     int (*kcomp)(const void * a, const void * b);
+    uint32_t (*khash)(const void * key);
+    egVec hashes;
+    struct egMapSlot * slots;
+    size_t slot_count;
 };
 
+#define EG_SOA_MAX_COLUMNS	16
+#define EG_SOA_ALIGN		32
+
+//structure of arrays: up to EG_SOA_MAX_COLUMNS named columns sharing one element count and capacity.
+//each column is its own EG_SOA_ALIGN aligned buffer, padded to a whole number of EG_SOA_ALIGN bytes,
+//so a pass over one field streams only that field and simd kernels can read full vectors at the end
+typedef struct egSoA {
+    void * columns[EG_SOA_MAX_COLUMNS];
+    void * blocks[EG_SOA_MAX_COLUMNS];
+    size_t sizes[EG_SOA_MAX_COLUMNS];
+    const char * names[EG_SOA_MAX_COLUMNS];
+    size_t column_count;
+    size_t element_count;
+    size_t alloc_size;
+} egSoA;
+
 //vector constructor
 egVec eg_vec_new(size_t element_count, size_t element_size);
 
+//vector over alloc_size elements of buffer, which must outlive it. no heap allocation until it outgrows buffer
+egVec eg_vec_new_buffer(void * buffer, size_t alloc_size, size_t element_size);
+
+//vector that allocates from arena, which must outlive it. growing leaves the old buffer in the arena
+egVec eg_vec_new_arena(struct egMemArena * arena, size_t alloc_size, size_t element_size);
+
 //vector accessor
 void * eg_vec_at(egVec* v, size_t element);
 int eg_vec_pop(egVec* v, void * element);
 
+//the elements of v, valid until it grows
+egSpan eg_vec_span(egVec* v);
+
 //vector insertion
 int eg_vec_push(egVec* v, void * element );
+
+//append one or count uninitialized elements and return the first, or null if out of memory.
+//lets callers build elements in place instead of copying them in with push
+void * eg_vec_emplace(egVec* v);
+void * eg_vec_emplace_n(egVec* v, size_t count);
 int eg_vec_insert(egVec* v, void * element, size_t position);
 
 //vector maintainance
 int eg_vec_shrinkwrap(egVec* v);
 int eg_vec_resize(egVec* v, size_t new_allocsize);
 int eg_vec_erase(egVec* v, size_t position);
+
+//remove the element at position by moving the last one into its place. O(1), but doesn't keep the order
+int eg_vec_swap_remove(egVec* v, size_t position);
+
+//remove count elements starting at position with a single move of the tail
+int eg_vec_erase_range(egVec* v, size_t position, size_t count);
+
+//remove every element remove returns nonzero for, in one pass that keeps the order of the rest.
+//return the number removed
+size_t eg_vec_remove_if(egVec* v, int (*remove)(void * element, void * ctx), void * ctx);
 int eg_vec_clear(egVec* v);
 int eg_vec_free(egVec* v);
 
 //map constructor
 egMap eg_map_new(size_t alloc_size, size_t key_size, size_t value_size, int (*kcomp)(const void * a, const void * b));
+//sorted map whose keys and values are allocated from arena, see eg_vec_new_arena
+egMap eg_map_new_arena(struct egMemArena * arena, size_t alloc_size, size_t key_size, size_t value_size, int (*kcomp)(const void * a, const void * b));
+egMap eg_map_new_hash(size_t alloc_size, size_t key_size, size_t value_size, int (*kcomp)(const void * a, const void * b), uint32_t (*khash)(const void * key));
+
+//hash for the engine's fixed 16 byte names: fnv-1a over the bytes before the terminator, at most 16 of them
+uint32_t eg_hash_name16(const void * key);
 
 //map accessors
 int eg_map_at(egMap * m, size_t element, const void ** key, void ** value);
 void * eg_map_get(egMap * m, const void * key, size_t * el);
 
-//map insertion
+//insert count keys and values at once, given as packed arrays in any order. a sorted map sorts the batch
+//and merges it in, O((n + count) log count) instead of count inserts at O(n) each. return 0 if out of memory
+int eg_map_build(egMap * m, const void * keys, const void * values, size_t count);
+
+//make room for element_count entries
+int eg_map_reserve(egMap * m, size_t element_count);
+
+//map insertion. returns the inserted value. a hashed map overwrites the value of a key that is already there,
+//and returns 0 if out of memory. a sorted map adds a duplicate
 void * eg_map_insert(egMap * m, const void * key, void * value);
 
 //map maintainance
@@ -73,3 +170,34 @@ int eg_map_erase_at(egMap * m, size_t element);
 void eg_map_clear(egMap * m);
 void eg_map_free(egMap * m);
 
+//soa constructor. add the columns before pushing anything
+egSoA eg_soa_new(size_t alloc_size);
+
+//add a column of size byte elements. name is not copied. return the column index, or -1 if out of columns or memory
+int eg_soa_add_column(egSoA * s, const char * name, size_t size);
+
+//the index of the column called name, or -1
+int eg_soa_column(egSoA * s, const char * name);
+
+//soa accessors
+void * eg_soa_at(egSoA * s, size_t column, size_t element);
+
+//the aligned start of a column, valid until the soa grows
+void * eg_soa_data(egSoA * s, size_t column);
+
+//soa insertion. values has one pointer per column, to the new element's value or null to zero it.
+//return 0 if out of memory
+int eg_soa_push(egSoA * s, const void * const * values);
+
+//soa maintainance
+int eg_soa_resize(egSoA * s, size_t new_allocsize);
+
+//remove element, keeping the rest in order
+int eg_soa_erase(egSoA * s, size_t element);
+
+//remove element by moving the last one into its place
+int eg_soa_swap_remove(egSoA * s, size_t element);
+void eg_soa_swap(egSoA * s, size_t a, size_t b);
+void eg_soa_clear(egSoA * s);
+void eg_soa_free(egSoA * s);
+
@@ -21,6 +21,43 @@ THE SOFTWARE.
 */
 #pragma once
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 
 int eg_insertion_sort(void *data[], size_t n, int (*comp)(void*, void*));
 
+//comparators get the two elements and whatever context the caller passed to the sort
+typedef int (*egSortComp)(const void * a, const void * b, void * ctx);
+
+//sort n elements of size bytes in place. introsort: quicksort with a median of three pivot, switching to heapsort
+//if it recurses past 2 log n levels and to insertion sort below 16 elements, so O(n log n) whatever the input. not stable
+void eg_sort(void * data, size_t n, size_t size, egSortComp comp, void * ctx);
+
+//stable merge sort. scratch must have room for n elements, or be null to have one allocated.
+//return 0 if scratch couldn't be allocated
+int eg_sort_stable(void * data, size_t n, size_t size, void * scratch, egSortComp comp, void * ctx);
+
+//key and payload pairs for the radix sorts, ordered by unsigned key
+typedef struct egSortKey32 {
+    uint32_t key;
+    uint32_t value;
+} egSortKey32;
+
+typedef struct egSortKey64 {
+    uint64_t key;
+    uint64_t value;
+} egSortKey64;
+
+//stable lsd radix sort, a byte per pass. passes where every key has the same byte are skipped.
+//scratch must have room for n elements, or be null to have one allocated. return 0 if it couldn't be
+int eg_radix_sort32(egSortKey32 * data, size_t n, egSortKey32 * scratch);
+int eg_radix_sort64(egSortKey64 * data, size_t n, egSortKey64 * scratch);
+
+//map a float to a radix sort key with the same order. -0 sorts before +0, and nans past the infinities
+static inline uint32_t eg_sort_float_key(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+